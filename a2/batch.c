@@ -0,0 +1,238 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "mem.h"
+#include "assert.h"
+#include "batch.h"
+
+//each worker may run this many files ahead of the one being printed, which
+//bounds how much finished output sits in memory waiting for a slow file
+#define RESULTS_PER_THREAD 4
+
+struct result{
+  char *output; //everything the job wrote, from open_memstream
+  size_t length;
+  int failed;
+  const char *error; //message for stderr, or NULL
+  int done;
+};
+
+struct batch{
+  const char *progname;
+  char **paths;
+  int npaths;
+  Batch_setup *setup;
+  Batch_job *job;
+  Batch_teardown *teardown;
+  void *cl;
+  struct result *results;
+  int window; //how far past next_print a worker may claim a file
+  int next_claim; //next file for a worker to take
+  int next_print; //next file to be printed
+  pthread_mutex_t lock;
+  pthread_cond_t finished; //signalled whenever a result is done
+  pthread_cond_t printed; //signalled whenever a result has been printed
+};
+
+//runs the job on file i, leaving its output and status in results[i]
+static void run_job(struct batch *b, void *state, int i){
+  struct result *r=&b->results[i];
+  r->output=NULL;
+  r->length=0;
+  r->error=NULL;
+  FILE *out=open_memstream(&r->output, &r->length);
+  if(out==NULL){
+    r->failed=1;
+    r->error="could not allocate an output buffer";
+    return;
+  }
+  FILE *in=fopen(b->paths[i], "rb");
+  if(in==NULL){
+    r->failed=1;
+    r->error="could not open file for reading";
+  } else {
+    r->failed=b->job(state, b->paths[i], in, out, &r->error, b->cl)!=0;
+    fclose(in);
+  }
+  if(fclose(out)!=0 && !r->failed){
+    r->failed=1;
+    r->error="could not allocate an output buffer";
+  }
+}
+
+//prints the result for file i and frees its buffer
+static void print_result(struct batch *b, int i){
+  struct result *r=&b->results[i];
+  if(r->length>0){
+    fwrite(r->output, 1, r->length, stdout);
+  }
+  free(r->output);
+  r->output=NULL;
+  if(r->failed && r->error!=NULL){
+    fflush(stdout);
+    fprintf(stderr, "%s: %s: %s\n", b->progname, b->paths[i], r->error);
+  }
+}
+
+static void *work(void *vbatch){
+  struct batch *b=vbatch;
+  void *state=b->setup(b->cl);
+  for(;;){
+    pthread_mutex_lock(&b->lock);
+    while(b->next_claim<b->npaths && b->next_claim>=b->next_print+b->window){
+      pthread_cond_wait(&b->printed, &b->lock);
+    }
+    int i=b->next_claim;
+    if(i<b->npaths){
+      b->next_claim++;
+    }
+    pthread_mutex_unlock(&b->lock);
+    if(i>=b->npaths){
+      break;
+    }
+    run_job(b, state, i);
+    pthread_mutex_lock(&b->lock);
+    b->results[i].done=1;
+    pthread_cond_broadcast(&b->finished);
+    pthread_mutex_unlock(&b->lock);
+  }
+  b->teardown(state, b->cl);
+  return NULL;
+}
+
+int Batch_run(const char *progname, char **paths, int npaths, int nthreads,
+  Batch_setup *setup, Batch_job *job, Batch_teardown *teardown, void *cl){
+  assert(paths!=NULL || npaths==0);
+  assert(nthreads>0 && setup!=NULL && job!=NULL && teardown!=NULL);
+  if(npaths==0){
+    return 0;
+  }
+  struct batch b;
+  b.progname=progname;
+  b.paths=paths;
+  b.npaths=npaths;
+  b.setup=setup;
+  b.job=job;
+  b.teardown=teardown;
+  b.cl=cl;
+  b.results=CALLOC(npaths, sizeof(struct result));
+  b.window=nthreads*RESULTS_PER_THREAD;
+  b.next_claim=0;
+  b.next_print=0;
+  pthread_mutex_init(&b.lock, NULL);
+  pthread_cond_init(&b.finished, NULL);
+  pthread_cond_init(&b.printed, NULL);
+
+  pthread_t *threads=CALLOC(nthreads, sizeof(pthread_t));
+  int started=0;
+  if(nthreads>1){
+    for(; started<nthreads; started++){
+      if(pthread_create(&threads[started], NULL, work, &b)!=0){
+        break;
+      }
+    }
+  }
+  int failures=0;
+  if(started==0){
+    //one thread, or none could be started: run each job and print it here
+    void *state=setup(cl);
+    for(int i=0; i<npaths; i++){
+      run_job(&b, state, i);
+      failures+=b.results[i].failed;
+      print_result(&b, i);
+    }
+    teardown(state, cl);
+  } else {
+    for(int i=0; i<npaths; i++){
+      pthread_mutex_lock(&b.lock);
+      while(!b.results[i].done){
+        pthread_cond_wait(&b.finished, &b.lock);
+      }
+      pthread_mutex_unlock(&b.lock);
+      failures+=b.results[i].failed;
+      print_result(&b, i);
+      pthread_mutex_lock(&b.lock);
+      b.next_print=i+1;
+      pthread_cond_broadcast(&b.printed);
+      pthread_mutex_unlock(&b.lock);
+    }
+    for(int i=0; i<started; i++){
+      pthread_join(threads[i], NULL);
+    }
+  }
+  FREE(threads);
+  pthread_cond_destroy(&b.printed);
+  pthread_cond_destroy(&b.finished);
+  pthread_mutex_destroy(&b.lock);
+  FREE(b.results);
+  return failures;
+}
+
+int Batch_parse_threads(const char *progname, const char *arg){
+  char *endptr;
+  long n=strtol(arg, &endptr, 10);
+  if(*endptr!='\0' || *arg=='\0' || n<0 || n>BATCH_MAX_THREADS){
+    fprintf(stderr, "%s: bad thread count '%s'\n", progname, arg);
+    exit(1);
+  }
+  return (int)n;
+}
+
+int Batch_threads(int n){
+  if(n>0){
+    return n;
+  }
+  long cpus=sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus>0 ? (int)cpus : 1;
+}
+
+char **Batch_open_list(const char *progname, const char *list, int *npaths){
+  FILE *fp=strcmp(list, "-") ? fopen(list, "r") : stdin;
+  if(fp==NULL){
+    fprintf(stderr, "%s: Could not open file %s for reading\n", progname,
+      list);
+    exit(1);
+  }
+  char **paths=Batch_read_list(fp, npaths);
+  if(fp!=stdin){
+    fclose(fp);
+  }
+  return paths;
+}
+
+char **Batch_read_list(FILE *fp, int *npaths){
+  int capacity=64;
+  int count=0;
+  char **paths=ALLOC(capacity*(long)sizeof(char *));
+  char *line=NULL;
+  size_t line_size=0;
+  ssize_t length;
+  while((length=getline(&line, &line_size, fp))!=-1){
+    while(length>0 && (line[length-1]=='\n' || line[length-1]=='\r')){
+      line[--length]='\0';
+    }
+    if(length==0){
+      continue;
+    }
+    if(count==capacity){
+      capacity*=2;
+      RESIZE(paths, capacity*(long)sizeof(char *));
+    }
+    paths[count]=ALLOC(length+1);
+    memcpy(paths[count], line, length+1);
+    count++;
+  }
+  free(line);
+  *npaths=count;
+  return paths;
+}
+
+void Batch_free_list(char **paths, int npaths){
+  for(int i=0; i<npaths; i++){
+    FREE(paths[i]);
+  }
+  FREE(paths);
+}
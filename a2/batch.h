@@ -0,0 +1,96 @@
+/*************************************************
+Batch Processing
+Spencer Meldrum and Tim Alander
+
+This interface runs one job per input file on a fixed-size pool of worker
+threads.  Each worker gets its own state (for example a reusable UArray2_T
+or Bit2_T) that it keeps for every file it handles.  A job writes its output
+into a private in-memory buffer, and the buffers are copied to stdout in the
+order the files were given, so the output looks exactly as if the files had
+been processed one after another.
+
+A job that fails does not stop the batch.  Its error is printed to stderr,
+in order with the rest, and counted in the value Batch_run returns.
+*************************************************/
+
+#ifndef BATCH_INCLUDED
+#define BATCH_INCLUDED
+
+#include <stdio.h>
+
+/*************************************************
+Type: Batch_setup, Batch_job, Batch_teardown
+Purpose: These are the three functions a client supplies.  Batch_setup is
+called once in each worker thread to create that thread's state, and
+Batch_teardown is called with it when the thread is done.  Batch_job
+processes one open file, given its name, writing its results to out.  It
+returns 0 on success and nonzero on failure; on failure it may point *error
+at a message for stderr, or leave it NULL if the output already says what
+went wrong.
+Jobs run in several threads at once, so they must not raise exceptions or
+touch shared state other than through the closure.
+*************************************************/
+typedef void *Batch_setup(void *cl);
+typedef int Batch_job(void *state, const char *path, FILE *in, FILE *out,
+  const char **error, void *cl);
+typedef void Batch_teardown(void *state, void *cl);
+
+/*************************************************
+Function: Batch_run
+Arguments: The program name for error messages, the array of file names and
+its length, the number of worker threads, the three client functions, and a
+closure passed to all of them
+Purpose: This function opens each file, runs the job on it in one of the
+worker threads and prints the results in order.  Only a limited number of
+finished results are held in memory at a time.  Returns the number of files
+that could not be opened or whose job failed.
+*************************************************/
+int Batch_run(const char *progname, char **paths, int npaths, int nthreads,
+  Batch_setup *setup, Batch_job *job, Batch_teardown *teardown, void *cl);
+
+/*************************************************
+Function: Batch_parse_threads
+Arguments: The program name for error messages and a thread count argument
+Purpose: This function returns the count, from 0 to BATCH_MAX_THREADS, where
+0 means one thread per processor, which Batch_threads turns into a count.
+Anything else, including a count too large to start that many threads, is
+reported on stderr and the program exits with status 1.
+*************************************************/
+#define BATCH_MAX_THREADS 4096
+int Batch_parse_threads(const char *progname, const char *arg);
+
+/*************************************************
+Function: Batch_threads
+Arguments: A thread count from Batch_parse_threads
+Purpose: This function returns the count, or if it is 0 the number of
+processors currently online, or 1 if that cannot be found out.
+*************************************************/
+int Batch_threads(int n);
+
+/*************************************************
+Function: Batch_open_list
+Arguments: The program name for error messages, the name of a list of file
+names ("-" for stdin) and a place to store how many were read
+Purpose: This function reads the list with Batch_read_list and returns the
+names, to be freed with Batch_free_list.  If the list cannot be opened the
+error is reported on stderr and the program exits with status 1.
+*************************************************/
+char **Batch_open_list(const char *progname, const char *list, int *npaths);
+
+/*************************************************
+Function: Batch_read_list
+Arguments: A FILE pointer to a list of file names and a place to store how
+many were read
+Purpose: This function reads one file name per line, skipping blank lines,
+and returns a newly allocated array of newly allocated names.
+*************************************************/
+char **Batch_read_list(FILE *fp, int *npaths);
+
+/*************************************************
+Function: Batch_free_list
+Arguments: An array returned by Batch_read_list and its length
+Purpose: This function frees every name in the array and the array itself.
+*************************************************/
+void Batch_free_list(char **paths, int npaths);
+
+#endif
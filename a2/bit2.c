@@ -1,31 +1,104 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include "mem.h"
 #include "assert.h"
 #include "bit2.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+//the whole-bitmap logical operations, applied a word (or register) at a time
+typedef enum { WORD_AND, WORD_OR, WORD_XOR, WORD_ANDNOT } word_op;
 
 struct Bit2_T{
-  Bit_T Linear_Array;
+  uint64_t *words; //row-major, each row padded out to a whole word
+  long capacity; //number of words allocated, at least words_per_row*height
+  int words_per_row; //will be set by Bit2_new
   int height; //will be set by Bit2_new
   int width; //will be set by Bit2_new
 };
 
+//reverses the order of the bits inside each byte of a word.  The raw pbm
+//format stores the leftmost pixel in the most significant bit of a byte, but
+//we keep column c in bit c%64 of its word, so every byte has to be flipped
+static inline uint64_t reverse_byte_bits(uint64_t w){
+  w=((w>>1)&0x5555555555555555ULL) | ((w&0x5555555555555555ULL)<<1);
+  w=((w>>2)&0x3333333333333333ULL) | ((w&0x3333333333333333ULL)<<2);
+  w=((w>>4)&0x0F0F0F0F0F0F0F0FULL) | ((w&0x0F0F0F0F0F0F0F0FULL)<<4);
+  return w;
+}
+
+//byte k of a row lands in bits 8k..8k+7 of its word on every host
+static inline uint64_t load_le64(const unsigned char *p){
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w=__builtin_bswap64(w);
+#endif
+  return w;
+}
+
+static inline void store_le64(unsigned char *p, uint64_t w){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w=__builtin_bswap64(w);
+#endif
+  memcpy(p, &w, sizeof(w));
+}
+
+//mask of the bits that hold real pixels in the last word of a row
+static inline uint64_t last_word_mask(int width){
+  int used=width%64;
+  return used==0 ? ~0ULL : (1ULL<<used)-1;
+}
+
 Bit2_T Bit2_new(int init_width, int init_height){
+  assert(init_width>=0 && init_height>=0);
   Bit2_T newBitArray = NEW(newBitArray);
-  newBitArray->Linear_Array=Bit_new(init_width*init_height);
+  newBitArray->words_per_row=(init_width+63)/64;
+  long nwords=(long)newBitArray->words_per_row*init_height;
+  //CALLOC will not hand out an empty block, so empty bitmaps get one word
+  newBitArray->capacity=nwords>0 ? nwords : 1;
+  newBitArray->words=CALLOC(newBitArray->capacity, sizeof(uint64_t));
   newBitArray->height=init_height;
   newBitArray->width=init_width;
   return newBitArray;
 }
+
+void Bit2_reshape(Bit2_T t, int width, int height){
+  assert(t!=NULL && width>=0 && height>=0);
+  int words_per_row=(width+63)/64;
+  long nwords=(long)words_per_row*height;
+  if(nwords>t->capacity){
+    FREE(t->words);
+    t->capacity=nwords;
+    t->words=CALLOC(nwords, sizeof(uint64_t));
+  } else {
+    memset(t->words, 0, nwords*sizeof(uint64_t));
+  }
+  t->words_per_row=words_per_row;
+  t->width=width;
+  t->height=height;
+}
+
 int Bit2_get(Bit2_T t, int width, int height){
-  int temp_width=t->width;
-  return Bit_get(t->Linear_Array, height*temp_width+width);
+  assert(t!=NULL);
+  assert(width>=0 && width<t->width && height>=0 && height<t->height);
+  uint64_t word=t->words[(long)height*t->words_per_row+width/64];
+  return (word>>(width%64))&1;
 }
 
 int Bit2_put(Bit2_T t, int width, int height, int bit){
-  int temp_width=t->width;
-  //this is our formula to reach an index in a 1-d array via a width and height
-  int temp_value=Bit_put(t->Linear_Array, height*temp_width+width, bit);
+  assert(t!=NULL);
+  assert(bit==0 || bit==1);
+  assert(width>=0 && width<t->width && height>=0 && height<t->height);
+  //this is our formula to reach a word in a 1-d array via a width and height
+  uint64_t *word=&t->words[(long)height*t->words_per_row+width/64];
+  uint64_t mask=1ULL<<(width%64);
+  int temp_value=(*word&mask)!=0;
+  if(bit){ *word|=mask;
+  } else { *word&=~mask;}
   return temp_value;
 }
 
@@ -54,7 +127,7 @@ void Bit2_map_column_major(Bit2_T t, void apply(Bit2_T t, int width, int height,
   }
 }
 
-void Bit2_map_row_major(Bit2_T t,void apply(Bit2_T t, int width, int height, 
+void Bit2_map_row_major(Bit2_T t,void apply(Bit2_T t, int width, int height,
   void* cl), void *cl){
   for(int k=0; k<Bit2_height(t); k++) {
     for(int i=0; i<Bit2_width(t); i++){
@@ -63,8 +136,253 @@ void Bit2_map_row_major(Bit2_T t,void apply(Bit2_T t, int width, int height,
   }
 }
 
-void Bit2_free(Bit2_T t){
-  Bit_free(&t->Linear_Array);
-  free(t);
+int Bit2_packed_row_bytes(Bit2_T t){
+  assert(t!=NULL);
+  return (t->width+7)/8;
 }
 
+void Bit2_from_packed_rows(Bit2_T t, int first_row, int nrows,
+  const unsigned char *packed){
+  assert(t!=NULL && packed!=NULL);
+  assert(first_row>=0 && nrows>=0 && first_row+nrows<=t->height);
+  int row_bytes=Bit2_packed_row_bytes(t);
+  int full_words=row_bytes/8; //words we can load straight out of the row
+  int tail_bytes=row_bytes%8;
+  for(int k=0; k<nrows; k++){
+    const unsigned char *src=packed+(long)k*row_bytes;
+    uint64_t *dst=&t->words[(long)(first_row+k)*t->words_per_row];
+    for(int w=0; w<full_words; w++){
+      dst[w]=reverse_byte_bits(load_le64(src+8*w));
+    }
+    if(tail_bytes!=0){
+      unsigned char last[8]={0};
+      memcpy(last, src+8*full_words, tail_bytes);
+      dst[full_words]=reverse_byte_bits(load_le64(last));
+    }
+    //the pbm format lets the padding bits hold anything, so clear them
+    if(t->words_per_row>0){
+      dst[t->words_per_row-1]&=last_word_mask(t->width);
+    }
+  }
+}
+
+void Bit2_to_packed_rows(Bit2_T t, int first_row, int nrows,
+  unsigned char *packed){
+  assert(t!=NULL && packed!=NULL);
+  assert(first_row>=0 && nrows>=0 && first_row+nrows<=t->height);
+  int row_bytes=Bit2_packed_row_bytes(t);
+  int full_words=row_bytes/8;
+  int tail_bytes=row_bytes%8;
+  for(int k=0; k<nrows; k++){
+    const uint64_t *src=&t->words[(long)(first_row+k)*t->words_per_row];
+    unsigned char *dst=packed+(long)k*row_bytes;
+    for(int w=0; w<full_words; w++){
+      store_le64(dst+8*w, reverse_byte_bits(src[w]));
+    }
+    if(tail_bytes!=0){
+      unsigned char last[8];
+      store_le64(last, reverse_byte_bits(src[full_words]));
+      memcpy(dst+8*full_words, last, tail_bytes);
+    }
+  }
+}
+
+int Bit2_next_set(Bit2_T t, int row, int from, int to){
+  assert(t!=NULL && row>=0 && row<t->height);
+  assert(from>=0 && from<=to && to<=t->width);
+  if(from==to){
+    return to;
+  }
+  const uint64_t *words=&t->words[(long)row*t->words_per_row];
+  int w=from/64;
+  int last=(to-1)/64;
+  uint64_t bits=words[w]&(~0ULL<<(from%64));
+  while(bits==0){
+    if(++w>last){
+      return to;
+    }
+    bits=words[w];
+  }
+  int found=w*64+__builtin_ctzll(bits);
+  return found<to ? found : to;
+}
+
+int Bit2_next_clear(Bit2_T t, int row, int from, int to){
+  assert(t!=NULL && row>=0 && row<t->height);
+  assert(from>=0 && from<=to && to<=t->width);
+  if(from==to){
+    return to;
+  }
+  const uint64_t *words=&t->words[(long)row*t->words_per_row];
+  int w=from/64;
+  int last=(to-1)/64;
+  uint64_t bits=~words[w]&(~0ULL<<(from%64));
+  while(bits==0){
+    if(++w>last){
+      return to;
+    }
+    bits=~words[w];
+  }
+  int found=w*64+__builtin_ctzll(bits);
+  return found<to ? found : to;
+}
+
+int Bit2_prev_clear(Bit2_T t, int row, int from){
+  assert(t!=NULL && row>=0 && row<t->height);
+  assert(from>=0 && from<t->width);
+  const uint64_t *words=&t->words[(long)row*t->words_per_row];
+  int w=from/64;
+  int bit=from%64;
+  //keep only the bits at or to the left of "from" in its word
+  uint64_t keep=bit==63 ? ~0ULL : (2ULL<<bit)-1;
+  uint64_t bits=~words[w]&keep;
+  while(bits==0){
+    if(--w<0){
+      return -1;
+    }
+    bits=~words[w];
+  }
+  return w*64+63-__builtin_clzll(bits);
+}
+
+void Bit2_clear_range(Bit2_T t, int row, int lo, int hi){
+  assert(t!=NULL && row>=0 && row<t->height);
+  assert(lo>=0 && lo<=hi && hi<=t->width);
+  if(lo==hi){
+    return;
+  }
+  uint64_t *words=&t->words[(long)row*t->words_per_row];
+  int first=lo/64;
+  int last=(hi-1)/64;
+  uint64_t first_mask=~0ULL<<(lo%64);
+  uint64_t last_mask=last_word_mask(hi);
+  if(first==last){
+    words[first]&=~(first_mask&last_mask);
+    return;
+  }
+  words[first]&=~first_mask;
+  for(int w=first+1; w<last; w++){
+    words[w]=0;
+  }
+  words[last]&=~last_mask;
+}
+
+//applies op to n words of dst and src.  Padding bits are 0 in both, and all
+//four operations map 0 and 0 to 0, so the padding stays clear
+static void combine_words(uint64_t *dst, const uint64_t *src, long n,
+  word_op op){
+  long i=0;
+#if defined(__AVX2__)
+  for(; i+4<=n; i+=4){
+    __m256i a=_mm256_loadu_si256((const __m256i *)(dst+i));
+    __m256i b=_mm256_loadu_si256((const __m256i *)(src+i));
+    switch(op){
+      case WORD_AND: a=_mm256_and_si256(a, b); break;
+      case WORD_OR: a=_mm256_or_si256(a, b); break;
+      case WORD_XOR: a=_mm256_xor_si256(a, b); break;
+      case WORD_ANDNOT: a=_mm256_andnot_si256(b, a); break;
+    }
+    _mm256_storeu_si256((__m256i *)(dst+i), a);
+  }
+#elif defined(__SSE2__)
+  for(; i+2<=n; i+=2){
+    __m128i a=_mm_loadu_si128((const __m128i *)(dst+i));
+    __m128i b=_mm_loadu_si128((const __m128i *)(src+i));
+    switch(op){
+      case WORD_AND: a=_mm_and_si128(a, b); break;
+      case WORD_OR: a=_mm_or_si128(a, b); break;
+      case WORD_XOR: a=_mm_xor_si128(a, b); break;
+      case WORD_ANDNOT: a=_mm_andnot_si128(b, a); break;
+    }
+    _mm_storeu_si128((__m128i *)(dst+i), a);
+  }
+#endif
+  for(; i<n; i++){
+    switch(op){
+      case WORD_AND: dst[i]&=src[i]; break;
+      case WORD_OR: dst[i]|=src[i]; break;
+      case WORD_XOR: dst[i]^=src[i]; break;
+      case WORD_ANDNOT: dst[i]&=~src[i]; break;
+    }
+  }
+}
+
+static void combine(Bit2_T dst, Bit2_T src, word_op op){
+  assert(dst!=NULL && src!=NULL);
+  assert(dst->width==src->width && dst->height==src->height);
+  combine_words(dst->words, src->words, (long)dst->words_per_row*dst->height,
+    op);
+}
+
+void Bit2_and(Bit2_T dst, Bit2_T src){ combine(dst, src, WORD_AND); }
+void Bit2_or(Bit2_T dst, Bit2_T src){ combine(dst, src, WORD_OR); }
+void Bit2_xor(Bit2_T dst, Bit2_T src){ combine(dst, src, WORD_XOR); }
+void Bit2_andnot(Bit2_T dst, Bit2_T src){ combine(dst, src, WORD_ANDNOT); }
+
+void Bit2_not(Bit2_T t){
+  assert(t!=NULL);
+  if(t->words_per_row==0){
+    return;
+  }
+  uint64_t last_mask=last_word_mask(t->width);
+  for(int row=0; row<t->height; row++){
+    uint64_t *words=&t->words[(long)row*t->words_per_row];
+    for(int w=0; w<t->words_per_row; w++){
+      words[w]=~words[w];
+    }
+    //flipping turned the padding bits on, so clear them again
+    words[t->words_per_row-1]&=last_mask;
+  }
+}
+
+//the popcnt instruction is not part of the baseline x86-64 target, so check
+//for it at run time instead of relying on -mpopcnt
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(__POPCNT__)
+__attribute__((target("popcnt")))
+static long count_words_popcnt(const uint64_t *words, long n){
+  long count=0;
+  for(long i=0; i<n; i++){
+    count+=__builtin_popcountll(words[i]);
+  }
+  return count;
+}
+#endif
+
+static long count_words(const uint64_t *words, long n){
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(__POPCNT__)
+  if(__builtin_cpu_supports("popcnt")){
+    return count_words_popcnt(words, n);
+  }
+#endif
+  long count=0;
+  for(long i=0; i<n; i++){
+    count+=__builtin_popcountll(words[i]);
+  }
+  return count;
+}
+
+long Bit2_count(Bit2_T t){
+  assert(t!=NULL);
+  return count_words(t->words, (long)t->words_per_row*t->height);
+}
+
+int Bit2_count_row(Bit2_T t, int row){
+  assert(t!=NULL && row>=0 && row<t->height);
+  return count_words(&t->words[(long)row*t->words_per_row], t->words_per_row);
+}
+
+int Bit2_rows_equal(Bit2_T a, Bit2_T b, int first_row, int nrows){
+  assert(a!=NULL && b!=NULL && a->width==b->width);
+  assert(first_row>=0 && nrows>=0);
+  assert(first_row+nrows<=a->height && first_row+nrows<=b->height);
+  //padding bits are always 0, so equal rows are equal word for word
+  long offset=(long)first_row*a->words_per_row;
+  size_t bytes=(size_t)nrows*a->words_per_row*sizeof(uint64_t);
+  return memcmp(a->words+offset, b->words+offset, bytes)==0;
+}
+
+void Bit2_free(Bit2_T t){
+  assert(t!=NULL);
+  FREE(t->words);
+  FREE(t);
+}
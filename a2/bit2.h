@@ -4,15 +4,14 @@ Spencer Meldrum and Tim Alander
 
 This data structure stores a "2-D Array" of bits.
 We do this by assigning each coordinate pair (column, row) an index
-within a linear array.  The underlying inferface that we have utilized
-is the bit vector included in Hanson's C Libraries.
+within a linear array of 64-bit words.  Every row starts on a fresh word,
+so whole rows can be moved in and out with word-at-a-time operations
+instead of one call per bit.  Bits past the width of a row are always 0.
 *************************************************/
 
 #ifndef BIT2_T_INCLUDED
 #define BIT2_T_INCLUDED
 
-#include "bit.h"
-
 typedef struct Bit2_T *Bit2_T;
 
 /*************************************************
@@ -25,6 +24,17 @@ return a pointer to the newly allocated memory block
 
 Bit2_T Bit2_new(int init_width, int init_height);
 
+/*************************************************
+Function: Bit2_reshape
+Arguments: A pointer to the bit vector and a new width and height
+Purpose: This function gives an existing bit vector new dimensions and sets
+every bit to 0.  The storage is only reallocated when the new size does not
+fit in what the vector already has, so one vector can be reused for a long
+run of images.
+*************************************************/
+
+void Bit2_reshape(Bit2_T t, int width, int height);
+
 /*************************************************
 Function: Bit2_put
 Arguments: A pointer to the bit vector, the width and height of the
@@ -103,6 +113,132 @@ provided Bit Vector. Row indices will vary more quickly than column indices.
 void Bit2_map_row_major(Bit2_T t,void apply(Bit2_T t, int width, int height, 
 void* cl), void *cl);
 
+/*************************************************
+Function: Bit2_packed_row_bytes
+Arguments: A pointer to the bit vector
+Purpose: This will return the number of bytes one row takes up in the raw
+(P4) pbm format, which is the width rounded up to a whole number of bytes.
+*************************************************/
+
+int Bit2_packed_row_bytes(Bit2_T t);
+
+/*************************************************
+Function: Bit2_from_packed_rows
+Arguments: A pointer to the bit vector, the first row to fill, the number of
+rows to fill and a buffer holding those rows in raw pbm (P4) layout
+Purpose: This function copies nrows rows of packed bytes into the bit vector,
+starting at first_row.  Each row in the buffer is Bit2_packed_row_bytes long,
+and the most significant bit of each byte is the leftmost pixel.  Padding bits
+at the end of a row are ignored.
+*************************************************/
+
+void Bit2_from_packed_rows(Bit2_T t, int first_row, int nrows,
+ const unsigned char *packed);
+
+/*************************************************
+Function: Bit2_to_packed_rows
+Arguments: A pointer to the bit vector, the first row to copy out, the number
+of rows to copy out and a buffer big enough to hold them
+Purpose: This is the inverse of Bit2_from_packed_rows.  It writes nrows rows
+of the bit vector into the buffer in raw pbm (P4) layout, with any padding
+bits at the end of a row set to 0.
+*************************************************/
+
+void Bit2_to_packed_rows(Bit2_T t, int first_row, int nrows,
+ unsigned char *packed);
+
+/*************************************************
+Function: Bit2_next_set
+Arguments: A pointer to the bit vector, a row, and a half-open range of
+columns [from, to) within that row
+Purpose: This function returns the first column in the range whose bit is
+1, or "to" if there is none.  It skips 64 columns at a time over runs of 0s.
+*************************************************/
+
+int Bit2_next_set(Bit2_T t, int row, int from, int to);
+
+/*************************************************
+Function: Bit2_next_clear
+Arguments: A pointer to the bit vector, a row, and a half-open range of
+columns [from, to) within that row
+Purpose: This function returns the first column in the range whose bit is
+0, or "to" if there is none.  Starting it inside a run of 1s gives back the
+column just past the end of that run.
+*************************************************/
+
+int Bit2_next_clear(Bit2_T t, int row, int from, int to);
+
+/*************************************************
+Function: Bit2_prev_clear
+Arguments: A pointer to the bit vector, a row, and a column in that row
+Purpose: This function scans leftwards from (and including) the given column
+and returns the first column whose bit is 0, or -1 if the bits all the way
+to the left edge are 1.  One more than the result is the start of the run of
+1s that holds the given column.
+*************************************************/
+
+int Bit2_prev_clear(Bit2_T t, int row, int from);
+
+/*************************************************
+Function: Bit2_clear_range
+Arguments: A pointer to the bit vector, a row, and a half-open range of
+columns [lo, hi) within that row
+Purpose: This function sets every bit in the range to 0, a word at a time.
+*************************************************/
+
+void Bit2_clear_range(Bit2_T t, int row, int lo, int hi);
+
+/*************************************************
+Function: Bit2_and, Bit2_or, Bit2_xor, Bit2_andnot
+Arguments: Two pointers to bit vectors of the same width and height
+Purpose: These functions combine src into dst bit by bit, leaving src alone:
+dst = dst & src, dst | src, dst ^ src and dst & ~src respectively.  They work
+on whole 64-bit words, using SSE2 or AVX2 registers when the compiler is
+allowed to.  It is a c.r.e for the two bit vectors to differ in size.
+*************************************************/
+
+void Bit2_and(Bit2_T dst, Bit2_T src);
+void Bit2_or(Bit2_T dst, Bit2_T src);
+void Bit2_xor(Bit2_T dst, Bit2_T src);
+void Bit2_andnot(Bit2_T dst, Bit2_T src);
+
+/*************************************************
+Function: Bit2_not
+Arguments: A pointer to the bit vector
+Purpose: This function flips every bit in the bit vector in place, turning
+black pixels white and white pixels black.
+*************************************************/
+
+void Bit2_not(Bit2_T t);
+
+/*************************************************
+Function: Bit2_count
+Arguments: A pointer to the bit vector
+Purpose: This function returns the number of bits that are 1 in the whole
+bit vector, which for a bitmap is the number of black pixels.
+*************************************************/
+
+long Bit2_count(Bit2_T t);
+
+/*************************************************
+Function: Bit2_count_row
+Arguments: A pointer to the bit vector and a row
+Purpose: This function returns the number of bits that are 1 in one row.
+*************************************************/
+
+int Bit2_count_row(Bit2_T t, int row);
+
+/*************************************************
+Function: Bit2_rows_equal
+Arguments: Two pointers to bit vectors of the same width, the first row to
+compare and the number of rows to compare
+Purpose: This function returns 1 if rows first_row through
+first_row+nrows-1 hold exactly the same bits in both bit vectors, and 0
+otherwise.
+*************************************************/
+
+int Bit2_rows_equal(Bit2_T a, Bit2_T b, int first_row, int nrows);
+
 /*************************************************
 Function: Bit2_free
 Arguments: A pointer to the bit vector
@@ -0,0 +1,141 @@
+#include <stdlib.h>
+#include "mem.h"
+#include "assert.h"
+#include "edgefill.h"
+
+//the seed stack starts out this many entries long, and doubles when it is
+//full of seeds that still have work to do
+#define INITIAL_SEEDS 1024
+
+//A seed is a span of columns [lo, hi) that was just cleared in the row next
+//to "row", on the side "row - dir".  Black runs of "row" that overlap the
+//span belong to the same region.  A seed stands for the whole span rather
+//than for each run touching it, and only its first run is cleared when it is
+//popped, so the runs of a row wait as one seed instead of one seed each
+struct seed{
+  int row;
+  int lo, hi;
+  int dir; //1 if the cleared span is above the row, -1 if below
+};
+
+struct Edgefill_T{
+  struct seed *seeds;
+  long length; //number of seeds waiting to be filled
+  long capacity; //number of seeds that fit before the stack has to grow
+};
+
+//removes the seeds whose spans hold no black bits any more.  A region whose
+//runs join up in loops reaches most spans more than once, so most of what
+//is waiting on the stack for such a region has already been cleared
+static void drop_finished_seeds(Edgefill_T fill, Bit2_T bitmap){
+  long kept=0;
+  for(long k=0; k<fill->length; k++){
+    struct seed seed=fill->seeds[k];
+    if(Bit2_next_set(bitmap, seed.row, seed.lo, seed.hi)<seed.hi){
+      fill->seeds[kept++]=seed;
+    }
+  }
+  fill->length=kept;
+}
+
+//pushes the span [lo, hi) of "row" as a seed, unless it is empty or the row
+//is off the bitmap.  A full stack first drops its finished seeds, and only
+//grows if that leaves it more than half full, so it is sized by the seeds
+//that still have work to do
+static inline void push_seed(Edgefill_T fill, Bit2_T bitmap, int row, int lo,
+  int hi, int dir){
+  if(lo>=hi || row<0 || row>=Bit2_height(bitmap)){
+    return;
+  }
+  if(fill->length==fill->capacity){
+    drop_finished_seeds(fill, bitmap);
+    if(fill->length*2>fill->capacity){
+      fill->capacity*=2;
+      RESIZE(fill->seeds, fill->capacity*(long)sizeof(struct seed));
+    }
+  }
+  struct seed *seed=&fill->seeds[fill->length++];
+  seed->row=row;
+  seed->lo=lo;
+  seed->hi=hi;
+  seed->dir=dir;
+}
+
+//clears the black region containing (column, row), one run per iteration.
+//Each run [lo, hi) that is cleared pushes the rest of the span it was found
+//in, then the span it covers in the next row on, and on top the ends of the
+//run that stick out past the span, which touch the row it came from.  Runs
+//side by side in a row wait as one seed, and a branch of the region is
+//finished before the rest of the span it grew from is looked at, so combs
+//and grids of runs keep only a few seeds per row on the stack
+static void fill_from(Edgefill_T fill, Bit2_T bitmap, int column, int row){
+  int width=Bit2_width(bitmap);
+  int lo=Bit2_prev_clear(bitmap, row, column)+1;
+  int hi=Bit2_next_clear(bitmap, row, column, width);
+  Bit2_clear_range(bitmap, row, lo, hi);
+  push_seed(fill, bitmap, row-1, lo, hi, -1);
+  push_seed(fill, bitmap, row+1, lo, hi, 1);
+  while(fill->length!=0){
+    struct seed seed=fill->seeds[--fill->length];
+    int start=Bit2_next_set(bitmap, seed.row, seed.lo, seed.hi);
+    if(start==seed.hi){
+      continue;
+    }
+    lo=Bit2_prev_clear(bitmap, seed.row, start)+1;
+    hi=Bit2_next_clear(bitmap, seed.row, start, width);
+    Bit2_clear_range(bitmap, seed.row, lo, hi);
+    push_seed(fill, bitmap, seed.row, hi, seed.hi, seed.dir);
+    push_seed(fill, bitmap, seed.row+seed.dir, lo, hi, seed.dir);
+    push_seed(fill, bitmap, seed.row-seed.dir, lo, seed.lo, -seed.dir);
+    push_seed(fill, bitmap, seed.row-seed.dir, seed.hi, hi, -seed.dir);
+  }
+}
+
+Edgefill_T Edgefill_new(void){
+  Edgefill_T fill=NEW(fill);
+  fill->capacity=INITIAL_SEEDS;
+  fill->length=0;
+  fill->seeds=ALLOC(fill->capacity*(long)sizeof(struct seed));
+  return fill;
+}
+
+void Edgefill_clear_edges(Edgefill_T fill, Bit2_T bitmap){
+  assert(fill!=NULL && bitmap!=NULL);
+  int width=Bit2_width(bitmap);
+  int height=Bit2_height(bitmap);
+  if(width==0 || height==0){
+    return;
+  }
+  //each edge seed is drained before the next one is looked at, so the stack
+  //only ever holds the frontier of a single black region.  Once a region is
+  //cleared its other edge pixels read as white and are skipped
+  int column=Bit2_next_set(bitmap, 0, 0, width);
+  while(column<width){
+    fill_from(fill, bitmap, column, 0);
+    column=Bit2_next_set(bitmap, 0, column, width);
+  }
+  column=Bit2_next_set(bitmap, height-1, 0, width);
+  while(column<width){
+    fill_from(fill, bitmap, column, height-1);
+    column=Bit2_next_set(bitmap, height-1, column, width);
+  }
+  for(int row=1; row<height-1; row++){
+    if(Bit2_get(bitmap, 0, row)==1){
+      fill_from(fill, bitmap, 0, row);
+    }
+    if(Bit2_get(bitmap, width-1, row)==1){
+      fill_from(fill, bitmap, width-1, row);
+    }
+  }
+}
+
+long Edgefill_capacity(Edgefill_T fill){
+  assert(fill!=NULL);
+  return fill->capacity;
+}
+
+void Edgefill_free(Edgefill_T *fill){
+  assert(fill!=NULL && *fill!=NULL);
+  FREE((*fill)->seeds);
+  FREE(*fill);
+}
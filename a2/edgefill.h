@@ -0,0 +1,56 @@
+/*************************************************
+Edge Fill
+Spencer Meldrum and Tim Alander
+
+This interface removes black edges from a bitmap with a scanline flood fill.
+Instead of visiting one pixel at a time, each step clears a whole horizontal
+run of black bits and then looks for runs touching it in the rows just above
+and below.  Spans still waiting to be scanned are kept as seeds in one flat
+array that lives inside the Edgefill_T, so the same fill can be reused
+across many bitmaps without allocating per pixel.  A seed stands for a whole
+span of a row rather than for each run in it, which keeps the stack to a few
+seeds per row for regions such as combs and grids of runs.  Only tangled
+regions, like dense random noise, need more.
+*************************************************/
+
+#ifndef EDGEFILL_INCLUDED
+#define EDGEFILL_INCLUDED
+
+#include "bit2.h"
+
+typedef struct Edgefill_T *Edgefill_T;
+
+/*************************************************
+Function: Edgefill_new
+Arguments: none
+Purpose: This function allocates a fill engine with an empty seed stack.  The
+stack grows as needed and keeps its capacity between calls.
+*************************************************/
+Edgefill_T Edgefill_new(void);
+
+/*************************************************
+Function: Edgefill_clear_edges
+Arguments: A fill engine and the bitmap to clean
+Purpose: This function turns white every black pixel that is on the edge of
+the bitmap, as well as every black pixel joined to one of those by a chain of
+black pixels above, below, left or right of each other.
+*************************************************/
+void Edgefill_clear_edges(Edgefill_T fill, Bit2_T bitmap);
+
+/*************************************************
+Function: Edgefill_capacity
+Arguments: A fill engine
+Purpose: This function returns the number of seeds the stack has room for,
+which is at least the most it has held at once.
+*************************************************/
+long Edgefill_capacity(Edgefill_T fill);
+
+/*************************************************
+Function: Edgefill_free
+Arguments: A pointer to a fill engine
+Purpose: This function frees the engine and its seed stack and sets *fill
+to NULL.
+*************************************************/
+void Edgefill_free(Edgefill_T *fill);
+
+#endif
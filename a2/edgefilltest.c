@@ -0,0 +1,83 @@
+/*************************************************
+Edge Fill Test
+Spencer Meldrum and Tim Alander
+
+This program checks Edgefill_clear_edges on bitmaps built to be hard on a
+flood fill's stack: a comb of black teeth hanging from a black top edge, and
+a ladder of solid rows joined by every other pixel of the rows between them.
+Each border region is made of one run per tooth or rung in every row, and
+each bitmap also holds a black island that touches no edge.  The test checks
+that every edge pixel and nothing else is cleared, and that the seed stack
+never needs more than a few seeds per row.  It prints nothing and exits 0
+if every check passes.
+*************************************************/
+
+#include <stdlib.h>
+#include "assert.h"
+#include "bit2.h"
+#include "edgefill.h"
+
+//the bitmaps are far wider than they are tall, so a stack that holds a seed
+//per run of a row is much bigger than one that holds a few per row
+#define WIDTH 8000
+#define HEIGHT 512
+//the most seeds per row the stack may make room for
+#define SEEDS_PER_ROW 4
+
+//the island: a black rectangle with white all around it, near the bottom
+#define ISLAND_TOP (HEIGHT-4)
+#define ISLAND_BOTTOM (HEIGHT-2)
+#define ISLAND_LEFT 10
+#define ISLAND_RIGHT 20
+
+static int in_island(int column, int row){
+  return row>=ISLAND_TOP && row<ISLAND_BOTTOM && column>=ISLAND_LEFT
+    && column<ISLAND_RIGHT;
+}
+
+//a black top row with a tooth in every other column below it, down to just
+//above the island's rows, and white down the sides and along the bottom
+static int comb(int column, int row){
+  if(row==0){
+    return 1;
+  }
+  return row<ISLAND_TOP-1 && column>0 && column<WIDTH-1 && column%2==0;
+}
+
+//solid even rows and, in the odd rows between them, every other pixel, down
+//to just above the island's rows
+static int ladder(int column, int row){
+  if(row>=ISLAND_TOP-1){
+    return 0;
+  }
+  return row%2==0 || column%2==0;
+}
+
+static void test_shape(Edgefill_T fill, int shape(int column, int row)){
+  Bit2_T bitmap=Bit2_new(WIDTH, HEIGHT);
+  for(int row=0; row<HEIGHT; row++){
+    for(int column=0; column<WIDTH; column++){
+      Bit2_put(bitmap, column, row,
+        shape(column, row) || in_island(column, row));
+    }
+  }
+  Edgefill_clear_edges(fill, bitmap);
+  for(int row=0; row<HEIGHT; row++){
+    for(int column=0; column<WIDTH; column++){
+      assert(Bit2_get(bitmap, column, row)==in_island(column, row));
+    }
+  }
+  assert(Edgefill_capacity(fill)<=SEEDS_PER_ROW*HEIGHT);
+  Bit2_free(bitmap);
+}
+
+int main(void){
+  //a new engine for each shape, so neither inherits the other's capacity
+  Edgefill_T fill=Edgefill_new();
+  test_shape(fill, comb);
+  Edgefill_free(&fill);
+  fill=Edgefill_new();
+  test_shape(fill, ladder);
+  Edgefill_free(&fill);
+  return EXIT_SUCCESS;
+}
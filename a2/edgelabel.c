@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include "mem.h"
+#include "assert.h"
+#include "edgelabel.h"
+
+//each worker gets about this many tiles, so a slow tile does not leave the
+//other threads idle at the end of a pass
+#define TILES_PER_THREAD 8
+
+//the passes over the tiles, in order.  Each one needs the finished results
+//of the one before it
+enum { COUNT_RUNS, LABEL_RUNS, JOIN_TILES, MARK_EDGES, CLEAR_MARKED, PHASES };
+
+struct labeling{
+  Bit2_T bitmap;
+  int width;
+  int height;
+  int tile_rows; //number of rows in every tile but the last
+  int ntiles;
+  int next_tile[PHASES]; //next tile of each pass, only touched atomically
+  long nruns;
+  pthread_mutex_t start; //held by the caller while it starts the threads
+  pthread_barrier_t barrier; //between the passes, for every thread
+  long *row_first; //index of the first run of each row, plus one past the end
+  int *run_lo; //first column of each run
+  int *run_hi; //one past the last column of each run
+  int *parent; //union-find forest over the runs, parent[i]<=i always
+  unsigned char *on_edge; //set for the root of every component on the edge
+};
+
+//one pass over the rows [first_row, end_row) of a single tile
+typedef void phase_fun(struct labeling *l, int first_row, int end_row);
+
+//finds the root of run x, halving the path as it goes.  Other threads may be
+//linking roots at the same time, so every access is atomic
+static int find_root(int *parent, int x){
+  for(;;){
+    int p=__atomic_load_n(&parent[x], __ATOMIC_RELAXED);
+    if(p==x){
+      return x;
+    }
+    int grandparent=__atomic_load_n(&parent[p], __ATOMIC_RELAXED);
+    if(grandparent!=p){
+      __atomic_compare_exchange_n(&parent[x], &p, grandparent, 0,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+    x=grandparent;
+  }
+}
+
+//joins the components of runs a and b.  The larger root is pointed at the
+//smaller one, and only if it is still a root, so racing unions just retry
+static void join_runs(int *parent, int a, int b){
+  for(;;){
+    a=find_root(parent, a);
+    b=find_root(parent, b);
+    if(a==b){
+      return;
+    }
+    if(a<b){
+      int temp=a;
+      a=b;
+      b=temp;
+    }
+    int expected=a;
+    if(__atomic_compare_exchange_n(&parent[a], &expected, b, 0,
+      __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+      return;
+    }
+  }
+}
+
+//joins every run of row "upper" with the runs of row upper+1 that it touches.
+//Both rows are sorted by column, so one merge-like walk finds every overlap
+static void join_rows(struct labeling *l, int upper){
+  long i=l->row_first[upper];
+  long i_end=l->row_first[upper+1];
+  long k=i_end;
+  long k_end=l->row_first[upper+2];
+  while(i<i_end && k<k_end){
+    if(l->run_lo[i]<l->run_hi[k] && l->run_lo[k]<l->run_hi[i]){
+      join_runs(l->parent, i, k);
+    }
+    //whichever run ends first cannot touch anything further along
+    if(l->run_hi[i]<=l->run_hi[k]){
+      i++;
+    } else {
+      k++;
+    }
+  }
+}
+
+static void count_runs(struct labeling *l, int first_row, int end_row){
+  for(int row=first_row; row<end_row; row++){
+    long count=0;
+    int column=Bit2_next_set(l->bitmap, row, 0, l->width);
+    while(column<l->width){
+      count++;
+      column=Bit2_next_clear(l->bitmap, row, column, l->width);
+      column=Bit2_next_set(l->bitmap, row, column, l->width);
+    }
+    l->row_first[row+1]=count;
+  }
+}
+
+static void label_runs(struct labeling *l, int first_row, int end_row){
+  for(int row=first_row; row<end_row; row++){
+    long run=l->row_first[row];
+    int column=Bit2_next_set(l->bitmap, row, 0, l->width);
+    while(column<l->width){
+      l->run_lo[run]=column;
+      column=Bit2_next_clear(l->bitmap, row, column, l->width);
+      l->run_hi[run]=column;
+      l->parent[run]=run;
+      run++;
+      column=Bit2_next_set(l->bitmap, row, column, l->width);
+    }
+  }
+  for(int row=first_row; row+1<end_row; row++){
+    join_rows(l, row);
+  }
+}
+
+//joins the first row of a tile to the last row of the tile above it
+static void join_tiles(struct labeling *l, int first_row, int end_row){
+  (void)end_row;
+  if(first_row>0){
+    join_rows(l, first_row-1);
+  }
+}
+
+static void mark_edges(struct labeling *l, int first_row, int end_row){
+  for(int row=first_row; row<end_row; row++){
+    int edge_row=row==0 || row==l->height-1;
+    for(long run=l->row_first[row]; run<l->row_first[row+1]; run++){
+      if(edge_row || l->run_lo[run]==0 || l->run_hi[run]==l->width){
+        __atomic_store_n(&l->on_edge[find_root(l->parent, run)], 1,
+          __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+static void clear_marked(struct labeling *l, int first_row, int end_row){
+  for(int row=first_row; row<end_row; row++){
+    for(long run=l->row_first[row]; run<l->row_first[row+1]; run++){
+      if(l->on_edge[find_root(l->parent, run)]){
+        Bit2_clear_range(l->bitmap, row, l->run_lo[run], l->run_hi[run]);
+      }
+    }
+  }
+}
+
+static phase_fun *const phases[PHASES]={
+  count_runs, label_runs, join_tiles, mark_edges, clear_marked
+};
+
+//turns the run counts into the index of each row's first run and makes room
+//for the runs
+static void size_runs(struct labeling *l){
+  for(int row=0; row<l->height; row++){
+    l->row_first[row+1]+=l->row_first[row];
+  }
+  l->nruns=l->row_first[l->height];
+  assert(l->nruns<=INT_MAX);
+  if(l->nruns==0){
+    return;
+  }
+  l->run_lo=ALLOC(l->nruns*(long)sizeof(int));
+  l->run_hi=ALLOC(l->nruns*(long)sizeof(int));
+  l->parent=ALLOC(l->nruns*(long)sizeof(int));
+  l->on_edge=CALLOC(l->nruns, 1);
+}
+
+//does tiles of one pass until none are left, then waits for the other
+//threads to finish theirs.  Returns 1 in exactly one of the threads
+static int run_phase(struct labeling *l, int phase){
+  for(;;){
+    int tile=__atomic_fetch_add(&l->next_tile[phase], 1, __ATOMIC_RELAXED);
+    if(tile>=l->ntiles){
+      break;
+    }
+    int first_row=tile*l->tile_rows;
+    int end_row=first_row+l->tile_rows;
+    if(end_row>l->height){ end_row=l->height; }
+    phases[phase](l, first_row, end_row);
+  }
+  return pthread_barrier_wait(&l->barrier)==PTHREAD_BARRIER_SERIAL_THREAD;
+}
+
+//every thread, the caller included, runs all of the passes, so the threads
+//are started once per bitmap and the barrier keeps the passes apart
+static void *work(void *vl){
+  struct labeling *l=vl;
+  //the barrier is ready once the caller knows how many threads started
+  pthread_mutex_lock(&l->start);
+  pthread_mutex_unlock(&l->start);
+  if(run_phase(l, COUNT_RUNS)){
+    size_runs(l);
+  }
+  pthread_barrier_wait(&l->barrier);
+  if(l->nruns==0){
+    return NULL;
+  }
+  for(int phase=LABEL_RUNS; phase<PHASES; phase++){
+    run_phase(l, phase);
+  }
+  return NULL;
+}
+
+void Edgelabel_clear_edges(Bit2_T bitmap, int nthreads){
+  assert(bitmap!=NULL && nthreads>0);
+  struct labeling l;
+  l.bitmap=bitmap;
+  l.width=Bit2_width(bitmap);
+  l.height=Bit2_height(bitmap);
+  if(l.width==0 || l.height==0){
+    return;
+  }
+  l.ntiles=nthreads*TILES_PER_THREAD;
+  if(l.ntiles>l.height){ l.ntiles=l.height; }
+  l.tile_rows=(l.height+l.ntiles-1)/l.ntiles;
+  l.ntiles=(l.height+l.tile_rows-1)/l.tile_rows;
+  for(int phase=0; phase<PHASES; phase++){
+    l.next_tile[phase]=0;
+  }
+  l.row_first=CALLOC(l.height+1, sizeof(long));
+
+  //thread 0 is the caller.  Tiles are handed out as threads ask for them,
+  //so if a thread cannot be started the others just do its share
+  pthread_t *threads=CALLOC(nthreads, sizeof(pthread_t));
+  pthread_mutex_init(&l.start, NULL);
+  pthread_mutex_lock(&l.start);
+  int started=1;
+  for(; started<nthreads; started++){
+    if(pthread_create(&threads[started], NULL, work, &l)!=0){
+      break;
+    }
+  }
+  pthread_barrier_init(&l.barrier, NULL, started);
+  pthread_mutex_unlock(&l.start);
+  work(&l);
+  for(int i=1; i<started; i++){
+    pthread_join(threads[i], NULL);
+  }
+  pthread_barrier_destroy(&l.barrier);
+  pthread_mutex_destroy(&l.start);
+  FREE(threads);
+
+  FREE(l.row_first);
+  if(l.nruns>0){
+    FREE(l.run_lo);
+    FREE(l.run_hi);
+    FREE(l.parent);
+    FREE(l.on_edge);
+  }
+}
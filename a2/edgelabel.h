@@ -0,0 +1,32 @@
+/*************************************************
+Edge Labeling
+Spencer Meldrum and Tim Alander
+
+This interface removes black edges from a bitmap using several threads.  It
+gives the same result as Edgefill_clear_edges, but instead of flooding out
+from the edges it labels connected components:
+
+  1. The bitmap is cut into bands of rows (tiles) and a pool of worker
+     threads finds the horizontal black runs in every tile.
+  2. Runs that touch each other in neighbouring rows are joined in a shared
+     union-find.  Joins inside a tile and across tile borders all go through
+     the same lock-free union, so tiles can be handed out in any order.
+  3. A second parallel pass clears every run whose component has a run on
+     the edge of the image.
+*************************************************/
+
+#ifndef EDGELABEL_INCLUDED
+#define EDGELABEL_INCLUDED
+
+#include "bit2.h"
+
+/*************************************************
+Function: Edgelabel_clear_edges
+Arguments: The bitmap to clean and the number of worker threads to use
+Purpose: This function turns white every black pixel that is joined to the
+edge of the bitmap by a chain of black pixels above, below, left or right of
+each other.  With one thread no extra threads are started.
+*************************************************/
+void Edgelabel_clear_edges(Bit2_T bitmap, int nthreads);
+
+#endif
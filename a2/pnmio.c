@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "pnmio.h"
+
+//plain bitmap text is built up in a buffer this big before each fwrite
+#define PLAIN_BUFFER_BYTES 65536
+
+//skips whitespace and '#' comments and returns the first other character
+static int skip_space(FILE *fp){
+  int c=getc(fp);
+  while(c!=EOF){
+    if(c=='#'){
+      while(c!='\n' && c!=EOF){ c=getc(fp); }
+    } else if(!isspace(c)){
+      return c;
+    } else {
+      c=getc(fp);
+    }
+  }
+  return EOF;
+}
+
+//reads one unsigned decimal header field.  The single character that ends
+//the number is consumed, which for the last field is the whitespace byte
+//that separates the header from the raster
+static int read_number(FILE *fp, unsigned *value){
+  int c=skip_space(fp);
+  if(!isdigit(c)){
+    return 0;
+  }
+  unsigned long n=0;
+  while(isdigit(c)){
+    n=n*10+(c-'0');
+    if(n>INT_MAX){
+      return 0;
+    }
+    c=getc(fp);
+  }
+  if(c!=EOF && !isspace(c)){
+    return 0;
+  }
+  *value=n;
+  return 1;
+}
+
+int Pnmio_read_header(FILE *fp, Pnmio_header *header){
+  if(getc(fp)!='P'){
+    return 0;
+  }
+  int magic=getc(fp);
+  if(magic<'1' || magic>'6'){
+    return 0;
+  }
+  //P1-P3 are the plain formats and P4-P6 the raw versions of the same types
+  header->raw=magic>='4';
+  header->type=header->raw ? magic-'3' : magic-'0';
+  unsigned width, height, denominator=1;
+  if(!read_number(fp, &width) || !read_number(fp, &height)){
+    return 0;
+  }
+  if(header->type!=1 && (!read_number(fp, &denominator) || denominator==0 ||
+    denominator>65535)){
+    return 0;
+  }
+  header->width=width;
+  header->height=height;
+  header->denominator=denominator;
+  return 1;
+}
+
+int Pnmio_read_bit_rows(FILE *fp, const Pnmio_header *header, int nrows,
+  unsigned char *packed){
+  int row_bytes=(header->width+7)/8;
+  if(header->raw){
+    size_t wanted=(size_t)row_bytes*nrows;
+    return fread(packed, 1, wanted, fp)==wanted;
+  }
+  //plain bitmaps are one character per pixel, so pack them as we go
+  memset(packed, 0, (size_t)row_bytes*nrows);
+  for(int k=0; k<nrows; k++){
+    unsigned char *row=packed+(long)k*row_bytes;
+    for(int i=0; i<header->width; i++){
+      int c=skip_space(fp);
+      if(c!='0' && c!='1'){
+        return 0;
+      }
+      if(c=='1'){
+        row[i/8]|=0x80>>(i%8);
+      }
+    }
+  }
+  return 1;
+}
+
+int Pnmio_read_gray(FILE *fp, const Pnmio_header *header, int count,
+  unsigned *samples){
+  for(int i=0; i<count; i++){
+    unsigned value;
+    if(!header->raw){
+      if(!read_number(fp, &value)){
+        return 0;
+      }
+    } else {
+      //raw samples are one byte, or two big-endian bytes past a maxval of 255
+      int high=header->denominator>255 ? getc(fp) : 0;
+      int low=getc(fp);
+      if(high==EOF || low==EOF){
+        return 0;
+      }
+      value=(unsigned)high<<8 | (unsigned)low;
+    }
+    if(value>header->denominator){
+      return 0;
+    }
+    samples[i]=value;
+  }
+  return 1;
+}
+
+int Pnmio_write_header(FILE *fp, const Pnmio_header *header){
+  int magic=header->type+(header->raw ? 3 : 0);
+  if(header->type==1){
+    return fprintf(fp, "P%i\n%i %i\n", magic, header->width,
+      header->height)>0;
+  }
+  return fprintf(fp, "P%i\n%i %i\n%u\n", magic, header->width,
+    header->height, header->denominator)>0;
+}
+
+int Pnmio_write_bit_rows(FILE *fp, const Pnmio_header *header, int nrows,
+  const unsigned char *packed){
+  int row_bytes=(header->width+7)/8;
+  if(header->raw){
+    size_t wanted=(size_t)row_bytes*nrows;
+    return fwrite(packed, 1, wanted, fp)==wanted;
+  }
+  char text[PLAIN_BUFFER_BYTES];
+  size_t used=0;
+  for(int k=0; k<nrows; k++){
+    const unsigned char *row=packed+(long)k*row_bytes;
+    for(int i=0; i<=header->width; i++){
+      if(used==sizeof(text)){
+        if(fwrite(text, 1, used, fp)!=used){
+          return 0;
+        }
+        used=0;
+      }
+      //one extra step past the last pixel ends the line
+      if(i==header->width){
+        text[used++]='\n';
+      } else {
+        text[used++]='0'+((row[i/8]>>(7-i%8))&1);
+      }
+    }
+  }
+  return fwrite(text, 1, used, fp)==used;
+}
@@ -0,0 +1,84 @@
+/*************************************************
+Pnm Input/Output
+Spencer Meldrum and Tim Alander
+
+This interface reads and writes netpbm images a whole row at a time instead
+of one pixel per call.  Bitmap rows are always handled in the raw pbm (P4)
+layout, eight pixels to a byte with the leftmost pixel in the most significant
+bit, whether the file itself is plain (P1) or raw (P4).  That is the layout
+Bit2_from_packed_rows and Bit2_to_packed_rows use, so a raw file goes
+straight between fread/fwrite and the bit vector.
+
+None of these functions raise exceptions.  They return 0 when the input is
+malformed or ends early, and the caller decides whether that is fatal.
+*************************************************/
+
+#ifndef PNMIO_INCLUDED
+#define PNMIO_INCLUDED
+
+#include <stdio.h>
+
+typedef struct Pnmio_header{
+  int type; //1 for a bitmap, 2 for a graymap, 3 for a pixmap
+  int raw; //1 for the binary formats (P4, P5, P6), 0 for the plain ones
+  int width;
+  int height;
+  unsigned denominator; //the maxval of the file, always 1 for bitmaps
+} Pnmio_header;
+
+/*************************************************
+Function: Pnmio_read_header
+Arguments: A FILE pointer positioned at the start of an image and a header
+struct to fill in
+Purpose: This function parses the magic number, the width, the height and
+(for graymaps and pixmaps) the maxval, skipping any comments.  It leaves fp
+at the first byte of pixel data.  Returns 1 on success and 0 if the header
+is not a netpbm header.
+*************************************************/
+int Pnmio_read_header(FILE *fp, Pnmio_header *header);
+
+/*************************************************
+Function: Pnmio_read_bit_rows
+Arguments: A FILE pointer left just after a bitmap header, the header that
+was read, the number of rows wanted and a buffer of
+nrows*((width+7)/8) bytes
+Purpose: This function reads the next nrows rows of a bitmap into the buffer
+in raw pbm layout.  Raw files are read with a single fread.  Returns 1 on
+success and 0 if the file ends early or holds something other than 0s and 1s.
+*************************************************/
+int Pnmio_read_bit_rows(FILE *fp, const Pnmio_header *header, int nrows,
+  unsigned char *packed);
+
+/*************************************************
+Function: Pnmio_read_gray
+Arguments: A FILE pointer left just after a graymap header, the header that
+was read, the number of samples wanted and an array to hold them
+Purpose: This function reads the next count samples of a graymap, plain or
+raw, in row-major order.  Returns 1 on success and 0 if the file ends early
+or a sample is larger than the header's maxval.
+*************************************************/
+int Pnmio_read_gray(FILE *fp, const Pnmio_header *header, int count,
+  unsigned *samples);
+
+/*************************************************
+Function: Pnmio_write_header
+Arguments: A FILE pointer and the header of the image about to be written
+Purpose: This function writes the magic number, width, height and (for
+graymaps and pixmaps) the maxval.  Returns 1 on success and 0 if the write
+failed.
+*************************************************/
+int Pnmio_write_header(FILE *fp, const Pnmio_header *header);
+
+/*************************************************
+Function: Pnmio_write_bit_rows
+Arguments: A FILE pointer just after a bitmap header, the header that was
+written, the number of rows and a buffer holding them in raw pbm layout
+Purpose: This function writes nrows rows of a bitmap.  A raw header gets the
+rows in one fwrite; a plain header gets one line of 0s and 1s per row, built
+up in a large buffer so there is no call per pixel either way.  Returns 1 on
+success and 0 if a write failed.
+*************************************************/
+int Pnmio_write_bit_rows(FILE *fp, const Pnmio_header *header, int nrows,
+  const unsigned char *packed);
+
+#endif
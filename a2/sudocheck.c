@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include "assert.h"
+#include "sudocheck.h"
+
+//each board's masks take 9 bits of a 64-bit word, so seven boards fit
+#define LANE_BITS 9
+#define LANES 7
+#define FULL_MASK 0x1FFu
+
+//returns the mask bit for a cell, or 0 if the cell is not a digit from 1 to
+//9.  For a 0 the subtraction wraps around and fails the comparison
+static inline uint64_t digit_bit(unsigned char value){
+  unsigned d=value-1u;
+  return (uint64_t)(d<9u) << (d&15u);
+}
+
+//checks nlanes boards starting at cells, side by side, storing one result
+//per board.  Lane b of every mask word belongs to board b
+static void check_lanes(const unsigned char *cells, int nlanes,
+  unsigned char *results){
+  uint64_t rows[9]={0}, columns[9]={0}, boxes[9]={0};
+  for(int r=0; r<9; r++){
+    for(int c=0; c<9; c++){
+      int k=r*9+c;
+      uint64_t bits=0;
+      for(int b=0; b<nlanes; b++){
+        bits|=digit_bit(cells[(long)b*SUDOCHECK_CELLS+k]) << (LANE_BITS*b);
+      }
+      rows[r]|=bits;
+      columns[c]|=bits;
+      boxes[r/3*3+c/3]|=bits;
+    }
+  }
+  //a lane is solved only if it is full in every one of the 27 groups
+  uint64_t all=~(uint64_t)0;
+  for(int i=0; i<9; i++){
+    all&=rows[i] & columns[i] & boxes[i];
+  }
+  for(int b=0; b<nlanes; b++){
+    results[b]=((all >> (LANE_BITS*b)) & FULL_MASK)==FULL_MASK;
+  }
+}
+
+int Sudocheck_board(const unsigned char *cells){
+  assert(cells!=NULL);
+  unsigned char result;
+  check_lanes(cells, 1, &result);
+  return result;
+}
+
+void Sudocheck_boards(const unsigned char *cells, long nboards,
+  unsigned char *results){
+  assert(nboards>=0);
+  assert(nboards==0 || (cells!=NULL && results!=NULL));
+  long i=0;
+  for(; i+LANES<=nboards; i+=LANES){
+    check_lanes(cells+i*SUDOCHECK_CELLS, LANES, results+i);
+  }
+  for(; i<nboards; i++){
+    results[i]=Sudocheck_board(cells+i*SUDOCHECK_CELLS);
+  }
+}
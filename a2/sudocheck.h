@@ -0,0 +1,43 @@
+/*************************************************
+Sudoku Check
+Spencer Meldrum and Tim Alander
+
+This interface checks sudoku boards using occupancy masks instead of arrays.
+Each row, column and 3x3 box is kept as a 9-bit mask with bit d-1 set once
+the digit d has been seen in it.  A group of nine cells can only fill all
+nine bits if every cell holds a different digit from 1 to 9, so a board is a
+solution exactly when all 27 masks come out as 0x1FF.  That takes one pass
+over the 81 cells and no allocation.
+
+A board here is 81 bytes in row-major order, one cell per byte, which is
+also the packed format sudoku reads with -packed.  Any byte outside 1 to 9
+(such as a 0 for an empty cell) makes the board unsolved.
+*************************************************/
+
+#ifndef SUDOCHECK_INCLUDED
+#define SUDOCHECK_INCLUDED
+
+#define SUDOCHECK_CELLS 81
+
+/*************************************************
+Function: Sudocheck_board
+Arguments: The 81 cells of a board
+Purpose: This function returns 1 if the board is a solved sudoku and 0
+otherwise.
+*************************************************/
+int Sudocheck_board(const unsigned char *cells);
+
+/*************************************************
+Function: Sudocheck_boards
+Arguments: An array of nboards boards, 81 bytes each, and an array of
+nboards results
+Purpose: This function sets results[i] to 1 if board i is solved and to 0
+otherwise.  Boards are checked seven at a time, with the masks of all seven
+packed into one 64-bit word, so one OR updates a row, column or box of every
+board in the group and one comparison finishes them.  Any leftover boards
+are checked one at a time.
+*************************************************/
+void Sudocheck_boards(const unsigned char *cells, long nboards,
+  unsigned char *results);
+
+#endif
@@ -5,18 +5,46 @@ Spencer Meldrum and Tim Alander
 This program takes in as input a pgm that we then parse and place
 into a "2-D UArray".  The elements are then check to see if they form
 a valid Sudoku solution (specifications provided in the README). If
-it is a solution, this program will return 0.  Otherwise, it will exit(1) on
-a failure of an assertion.
+it is a solution, this program will return 0.  Otherwise, it will exit(1).
+
+With -batch N, or -files LIST to read the file names from LIST ("-" for
+stdin), the boards are checked N at a time (N=0 means one per processor) and
+one line per file says whether it is solved.  A file that cannot be read is
+reported and skipped instead of ending the run, and the exit status is 1 if
+any file was not a solved board.
+
+With -stream the files (or stdin) hold many pgm boards one after another,
+and with -packed they hold boards of 81 bytes each, one cell per byte in
+row-major order.  Either way one line per board says whether it is solved,
+and the boards are checked several at a time by Sudocheck_boards.
+
+With -solve the boards (one after another, as pgms or with -packed as 81
+byte boards) may have 0s for empty cells.  Each one is completed by the
+solver and written to stdout in the format it was read in.  A summary on
+stderr gives the boards solved per second and the search nodes per board,
+counting only time spent in the solver.
 
 *************************************************/
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
 #include "pnmrdr.h"
 #include "pnm.h"
 #include "stackoverflow.h"
 #include "bitpack.h"
 #include "assert.h"
+#include "mem.h"
 #include "uarray2.h"
+#include "pnmio.h"
+#include "batch.h"
+#include "sudocheck.h"
+#include "sudosolve.h"
+
+//boards are read and checked this many at a time in the streaming modes
+#define STREAM_BOARDS 4096
 
 /*************************************************
 Function: set_sudoku_values
@@ -35,35 +63,178 @@ will return a pointer to that new UArray
 *************************************************/
 void check_file(FILE* fp, UArray2_T sudoku);
 /*************************************************
-Function:check_boxes
+Function: copy_row
+Arguments: the row index, a pointer to the row's elements, how many there
+are, and an 81 byte board
+Purpose: This apply function is called by UArray2_map_rows to copy the
+board a row at a time into the byte layout that Sudocheck_board checks.
+*************************************************/
+static void copy_row(int row, void *elements, int count, void *cells);
+/*************************************************
+Function:is_solved
 Arguments: A UArray pointer that holds the sudoku information
-Purpose: This function will check the 9 sub-boxes of the 9x9 sudoku
-board to make sure that those small 3x3 squares have no overlap in
-terms of intensity.  If they do have overlap, it will throw out a
-CRE and exit(1).
+Purpose: This function checks every row, column and box in one pass with
+Sudocheck_board and returns 1 if the board is a solution and 0 otherwise.
+*************************************************/
+int is_solved(UArray2_T sudoku);
+/*************************************************
+Function:read_board
+Arguments: A FILE pointer to a pgm, the UArray to put the board in, and a
+place to store whether every cell held a number from 1 to 9
+Purpose: This is the batch mode version of check_file.  Instead of raising
+an exception it returns an error message if the file is not a 9x9 pgm with
+a maxval of 9, and NULL otherwise.
+*************************************************/
+const char *read_board(FILE *fp, UArray2_T sudoku, int *complete);
+/*************************************************
+Function:read_cells
+Arguments: A FILE pointer to a pgm and an 81 byte board
+Purpose: This function reads one 9x9 pgm with a maxval of 9 into the board,
+in row-major order.  It returns an error message if the file is not such a
+pgm and NULL otherwise.
+*************************************************/
+const char *read_cells(FILE *fp, unsigned char *cells);
+/*************************************************
+Function:stream_file
+Arguments: The name to print for a file, a FILE pointer to it, whether it
+holds packed boards rather than pgms, and buffers for STREAM_BOARDS boards
+and their results
+Purpose: This function reads every board in the file, checking them
+STREAM_BOARDS at a time, and prints one line per board.  It returns the
+number of boards that were not solved, plus one if the file held something
+other than whole boards.
+*************************************************/
+long stream_file(const char *name, FILE *fp, int packed, unsigned char *cells,
+  unsigned char *results);
+/*************************************************
+Function:check_job
+Arguments: The UArray of a batch worker, the name of the file, the input
+and output files, where to put an error message, and a closure
+Purpose: This is the job that Batch_run calls for every file in batch mode.
+It prints one line saying whether the file holds a solved board.
 *************************************************/
-void check_boxes(UArray2_T sudoku);
+static int check_job(void *state, const char *path, FILE *in, FILE *out,
+  const char **error, void *cl);
 /*************************************************
-Function:check_linear_values
-Arguments: A UArray pointer that holds the sudoku information,
-modularity integer that switches between horizontal and vertical checks
-Purpose: This function will check the 9 rows and 9 columns to make sure
-that no intensity appears twice in 2-D Array.  If any do, the function
-will throw a CDE and exit(1).  This function incorporates both vertical
-and horizontal functions which slimmed down our code significantly.
+Type: solve_stats
+Purpose: This struct adds up what the solver did over every file in -solve
+mode, for the summary printed at the end.
 *************************************************/
-void check_linear_values(UArray2_T sudoku, int modular);
+typedef struct solve_stats{
+  long boards;
+  long solved;
+  long nodes;
+  double seconds;
+} solve_stats;
+/*************************************************
+Function:solve_file
+Arguments: The name to print for a file, a FILE pointer to it, whether it
+holds packed boards rather than pgms, a solver, a 9x9 UArray to hold each
+board and the stats to add to
+Purpose: This function solves every board in the file and writes each
+completed board to stdout.  It returns the number of boards that could not
+be solved, plus one if the file held something other than whole boards.
+*************************************************/
+long solve_file(const char *name, FILE *fp, int packed, Sudosolve_T solver,
+  UArray2_T sudoku, solve_stats *stats);
+static void *new_board(void *cl);
+static void free_board(void *state, void *cl);
 
 
 int main(int argc, char *argv[]) {
+  int batch_threads=-1; //-1 unless batch mode was asked for
+  const char *list=NULL;
+  int stream=0, packed=0, solve=0;
+  int first=1;
+  for (; first < argc && argv[first][0] == '-' && argv[first][1] != '\0';
+    first++) {
+    if (!strcmp(argv[first], "-batch") && first + 1 < argc) {
+      batch_threads=Batch_parse_threads(argv[0], argv[++first]);
+    } else if (!strcmp(argv[first], "-files") && first + 1 < argc) {
+      list=argv[++first];
+    } else if (!strcmp(argv[first], "-stream")) {
+      stream=1;
+    } else if (!strcmp(argv[first], "-packed")) {
+      packed=1;
+    } else if (!strcmp(argv[first], "-solve")) {
+      solve=1;
+    } else {
+      fprintf(stderr, "Usage: %s [-batch N] [-files LIST] [-solve]"
+        " [-stream | -packed] [filename...]\n", argv[0]);
+      exit(1);
+    }
+  }
+  if (solve) {
+    Sudosolve_T solver=Sudosolve_new();
+    UArray2_T sudoku=UArray2_new(9,9, sizeof(unsigned));
+    solve_stats stats={0, 0, 0, 0.0};
+    long failures=0;
+    if (first == argc) {
+      failures+=solve_file("stdin", stdin, packed, solver, sudoku, &stats);
+    }
+    for (int i = first; i < argc; i++) {
+      FILE *fp = fopen(argv[i], "rb");
+      if (fp == NULL) {
+        fprintf(stderr, "%s: Could not open file %s for reading\n",
+        argv[0], argv[i]);
+        failures++;
+        continue;
+      }
+      failures+=solve_file(argv[i], fp, packed, solver, sudoku, &stats);
+      fclose(fp);
+    }
+    fflush(stdout);
+    fprintf(stderr, "%s: solved %li of %li boards in %.3f s (%.0f boards/s,"
+      " %.1f nodes/board)\n", argv[0], stats.solved, stats.boards,
+      stats.seconds, stats.seconds>0 ? stats.boards/stats.seconds : 0.0,
+      stats.boards>0 ? (double)stats.nodes/stats.boards : 0.0);
+    UArray2_free(sudoku);
+    Sudosolve_free(&solver);
+    return failures == 0 ? 0 : 1;
+  }
+  if (stream || packed) {
+    unsigned char *cells=ALLOC(STREAM_BOARDS * SUDOCHECK_CELLS);
+    unsigned char *results=ALLOC(STREAM_BOARDS);
+    long failures=0;
+    if (first == argc) {
+      failures+=stream_file("stdin", stdin, packed, cells, results);
+    }
+    for (int i = first; i < argc; i++) {
+      FILE *fp = fopen(argv[i], "rb");
+      if (fp == NULL) {
+        fprintf(stderr, "%s: Could not open file %s for reading\n",
+        argv[0], argv[i]);
+        failures++;
+        continue;
+      }
+      failures+=stream_file(argv[i], fp, packed, cells, results);
+      fclose(fp);
+    }
+    FREE(cells);
+    FREE(results);
+    return failures == 0 ? 0 : 1;
+  }
+  if (list != NULL || batch_threads >= 0) {
+    char **paths=argv + first;
+    int npaths=argc - first;
+    if (list != NULL) {
+      paths=Batch_open_list(argv[0], list, &npaths);
+    }
+    int failures=Batch_run(argv[0], paths, npaths,
+      Batch_threads(batch_threads), new_board, check_job, free_board, NULL);
+    if (list != NULL) {
+      Batch_free_list(paths, npaths);
+    }
+    return failures == 0 ? 0 : 1;
+  }
   UArray2_T sudoku=UArray2_new(9,9, sizeof(unsigned));
-  if (argc == 1) {
+  if (first == argc) {
     check_file(stdin, sudoku);
-    check_linear_values(sudoku,0);
-    check_linear_values(sudoku,1);
-    check_boxes(sudoku);
+    if (!is_solved(sudoku)) {
+      exit(1);
+    }
   } else {
-    for (int i = 1; i < argc; i++) {
+    for (int i = first; i < argc; i++) {
       FILE *fp = fopen(argv[i], "r");
       if (fp == NULL) {
         fprintf(stderr, "%s: Could not open file %s for reading\n",
@@ -71,9 +242,9 @@ int main(int argc, char *argv[]) {
         exit(1);
       }
       check_file(fp, sudoku);
-      check_linear_values(sudoku,0);
-      check_linear_values(sudoku,1);
-      check_boxes(sudoku);
+      if (!is_solved(sudoku)) {
+        exit(1);
+      }
       fclose(fp);
     }
   }
@@ -99,56 +270,201 @@ static void set_sudoku_values(void * element, void * pnmfile){
   *UArray2_element=temp;
 }
 
-void check_linear_values(UArray2_T sudoku, int modular){
-  for(int i=0; i<9; i++){
-    int counter=0;
-    UArray_T temp_values=UArray_new(9, sizeof(unsigned));
-    for(int k=0; k<9; k++){
-      unsigned* index_element_pointer=NULL;
-      //this is the modularity in action.  If the modular is 1, it will
-      //check columns, else it will check rows for double intensities
-      if(modular==1){ index_element_pointer=UArray2_at(sudoku, k, i);
-      } else { index_element_pointer=UArray2_at(sudoku, i, k);}
-      unsigned index_element=*index_element_pointer;
-      for(int l=0; l<counter; l++){
-        unsigned* previous_number_pointer=(unsigned*)UArray_at(temp_values, l);
-        unsigned previous_number=*previous_number_pointer;
-        assert(index_element!=previous_number);
+static void copy_row(int row, void *elements, int count, void *cells){
+  const unsigned *values=elements;
+  unsigned char *out=(unsigned char *)cells+row*count;
+  for(int i=0; i<count; i++){
+    //anything too big for a byte could never be a digit, so make it a 0
+    out[i]=values[i]<10 ? values[i] : 0;
+  }
+}
+
+int is_solved(UArray2_T sudoku){
+  unsigned char cells[SUDOCHECK_CELLS];
+  UArray2_map_rows(sudoku, copy_row, cells);
+  return Sudocheck_board(cells);
+}
+
+const char *read_cells(FILE *fp, unsigned char *cells){
+  Pnmio_header header;
+  if(!Pnmio_read_header(fp, &header) || header.type!=2){
+    return "not a pgm file";
+  }
+  if(header.height!=9 || header.width!=9 || header.denominator!=9){
+    return "not a 9x9 pgm with a maxval of 9";
+  }
+  unsigned values[SUDOCHECK_CELLS];
+  if(!Pnmio_read_gray(fp, &header, SUDOCHECK_CELLS, values)){
+    return "pgm file is truncated or holds bad pixels";
+  }
+  for(int i=0; i<SUDOCHECK_CELLS; i++){
+    cells[i]=values[i];
+  }
+  return NULL;
+}
+
+const char *read_board(FILE *fp, UArray2_T sudoku, int *complete){
+  unsigned char cells[SUDOCHECK_CELLS];
+  const char *error=read_cells(fp, cells);
+  if(error!=NULL){
+    return error;
+  }
+  *complete=1;
+  for(int r=0; r<9; r++){
+    unsigned *row=UArray2_row(sudoku, r, NULL);
+    for(int c=0; c<9; c++){
+      //a 0 is an empty cell, so the board cannot be a solution
+      if(cells[r*9+c]==0){
+        *complete=0;
       }
-      unsigned* temp_pointer=UArray_at(temp_values, counter);
-      *temp_pointer=index_element;
-      counter++;
+      row[c]=cells[r*9+c];
+    }
+  }
+  return NULL;
+}
+
+//skips the whitespace between concatenated pgms and returns 1 if another
+//one follows
+static int more_boards(FILE *fp){
+  int c=getc(fp);
+  while(c!=EOF && isspace(c)){
+    c=getc(fp);
+  }
+  if(c==EOF){
+    return 0;
+  }
+  ungetc(c, fp);
+  return 1;
+}
+
+long stream_file(const char *name, FILE *fp, int packed, unsigned char *cells,
+  unsigned char *results){
+  long failures=0;
+  long number=0; //boards of this file printed so far
+  const char *error=NULL;
+  for(;;){
+    long count=0;
+    if(packed){
+      size_t bytes=fread(cells, 1, STREAM_BOARDS*SUDOCHECK_CELLS, fp);
+      count=bytes/SUDOCHECK_CELLS;
+      if(bytes%SUDOCHECK_CELLS!=0){
+        error="ends in the middle of a packed board";
+      }
+    } else {
+      while(count<STREAM_BOARDS && error==NULL && more_boards(fp)){
+        error=read_cells(fp, cells+count*SUDOCHECK_CELLS);
+        if(error==NULL){
+          count++;
+        }
+      }
+    }
+    Sudocheck_boards(cells, count, results);
+    for(long i=0; i<count; i++){
+      printf("%s:%li: %s\n", name, ++number,
+        results[i] ? "solved" : "not solved");
+      failures+=!results[i];
+    }
+    if(error!=NULL){
+      fflush(stdout);
+      fprintf(stderr, "%s:%li: %s\n", name, number+1, error);
+      return failures+1;
+    }
+    if(count<STREAM_BOARDS){
+      return failures;
     }
-    UArray_free(&temp_values);
   }
 }
 
-void check_boxes(UArray2_T sudoku){
-  //this algorithm takes the northwest-most of coordinates and then checks
-  //the respective boxes using those as starting points.  Therefore, we
-  //check (0,0),(0,3),(0,6), (3,0), (3,3), (3,6) etc. to make sure all
-  //the boxes are clean of double intensities
-  for(int i=0; i<9; i+=3){
-    for(int k=0;k<9; k+=3){
-      int counter=0;
-      UArray_T temp_values=UArray_new(9, sizeof(unsigned));
-      for(int y=0; y<3; y++){
-        for(int z=0; z<3; z++){
-          unsigned* index_element_pointer=NULL;
-          index_element_pointer=UArray2_at(sudoku, k+y, i+z);
-          unsigned index_element=*index_element_pointer;
-          for(int l=0; l<counter; l++){
-            unsigned* previous_number_pointer=(unsigned*)UArray_at(temp_values, 
-              l);
-            unsigned previous_number=*previous_number_pointer;
-            assert(index_element!=previous_number);
-          }
-          unsigned* temp_pointer=UArray_at(temp_values, counter);
-          *temp_pointer=index_element;
-          counter++;
+static double now(void){
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+long solve_file(const char *name, FILE *fp, int packed, Sudosolve_T solver,
+  UArray2_T sudoku, solve_stats *stats){
+  long failures=0;
+  long number=0; //boards of this file read so far
+  unsigned char cells[SUDOCHECK_CELLS];
+  for(;;){
+    const char *error=NULL;
+    if(packed){
+      size_t bytes=fread(cells, 1, SUDOCHECK_CELLS, fp);
+      if(bytes==0){
+        return failures;
+      }
+      if(bytes!=SUDOCHECK_CELLS){
+        error="ends in the middle of a packed board";
+      }
+      for(size_t i=0; i<bytes && error==NULL; i++){
+        if(cells[i]>9){
+          error="packed board holds a cell larger than 9";
         }
       }
-      UArray_free(&temp_values);
+    } else {
+      if(!more_boards(fp)){
+        return failures;
+      }
+      error=read_cells(fp, cells);
+    }
+    number++;
+    if(error!=NULL){
+      fflush(stdout);
+      fprintf(stderr, "%s:%li: %s\n", name, number, error);
+      return failures+1;
+    }
+    for(int r=0; r<9; r++){
+      unsigned *row=UArray2_row(sudoku, r, NULL);
+      for(int c=0; c<9; c++){
+        row[c]=cells[r*9+c];
+      }
+    }
+    double start=now();
+    int solved=Sudosolve_board(solver, sudoku);
+    stats->seconds+=now()-start;
+    stats->boards++;
+    stats->nodes+=Sudosolve_nodes(solver);
+    if(!solved){
+      fflush(stdout);
+      fprintf(stderr, "%s:%li: board has no solution\n", name, number);
+      failures++;
+      continue;
     }
+    stats->solved++;
+    UArray2_map_rows(sudoku, copy_row, cells);
+    if(packed){
+      fwrite(cells, 1, SUDOCHECK_CELLS, stdout);
+    } else {
+      printf("P2\n9 9\n9\n");
+      for(int r=0; r<9; r++){
+        for(int c=0; c<9; c++){
+          printf("%u%c", cells[r*9+c], c==8 ? '\n' : ' ');
+        }
+      }
+    }
+  }
+}
+
+static void *new_board(void *cl){
+  (void)cl;
+  return UArray2_new(9,9, sizeof(unsigned));
+}
+
+static void free_board(void *state, void *cl){
+  (void)cl;
+  UArray2_free(state);
+}
+
+static int check_job(void *state, const char *path, FILE *in, FILE *out,
+  const char **error, void *cl){
+  (void)cl;
+  UArray2_T sudoku=state;
+  int complete;
+  *error=read_board(in, sudoku, &complete);
+  if(*error!=NULL){
+    return 1;
   }
+  int solved=complete && is_solved(sudoku);
+  fprintf(out, "%s: %s\n", path, solved ? "solved" : "not solved");
+  return !solved;
 }
@@ -0,0 +1,240 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <pthread.h>
+#include "mem.h"
+#include "assert.h"
+#include "sudosolve.h"
+
+#define CELLS 81
+#define GROUPS 27
+#define ALL_DIGITS 0x1FFu
+
+//one board in the middle of being solved
+struct grid{
+  unsigned char cell[CELLS]; //0 for empty, otherwise the digit
+  uint16_t used[GROUPS]; //digits in rows 0-8, columns 9-17 and boxes 18-26
+  int filled;
+};
+
+//one level of the search: the board after the guess that led here, and the
+//guesses still to try on its most constrained cell
+struct frame{
+  struct grid grid;
+  int cell;
+  unsigned untried;
+};
+
+struct Sudosolve_T{
+  //the board can only be guessed on 81 times, plus the starting board
+  struct frame stack[CELLS+1];
+  long nodes;
+};
+
+//the three groups of every cell, and the nine cells of every group
+static unsigned char groups_of[CELLS][3];
+static unsigned char cells_of[GROUPS][9];
+static pthread_once_t tables_once=PTHREAD_ONCE_INIT;
+
+static void build_tables(void){
+  for(int k=0; k<CELLS; k++){
+    int r=k/9, c=k%9, b=r/3*3+c/3;
+    groups_of[k][0]=r;
+    groups_of[k][1]=9+c;
+    groups_of[k][2]=18+b;
+    cells_of[r][c]=k;
+    cells_of[9+c][r]=k;
+    cells_of[18+b][r%3*3+c%3]=k;
+  }
+}
+
+static inline unsigned candidates(const struct grid *g, int k){
+  const unsigned char *gr=groups_of[k];
+  return ~(g->used[gr[0]] | g->used[gr[1]] | g->used[gr[2]]) & ALL_DIGITS;
+}
+
+//puts digit (given as its mask bit) in empty cell k
+static inline void place(struct grid *g, int k, unsigned bit){
+  const unsigned char *gr=groups_of[k];
+  g->cell[k]=__builtin_ctz(bit)+1;
+  g->used[gr[0]]|=bit;
+  g->used[gr[1]]|=bit;
+  g->used[gr[2]]|=bit;
+  g->filled++;
+}
+
+//fills every cell with a single candidate.  Returns -1 if some empty cell
+//has no candidates, and otherwise the number of cells filled
+static int naked_singles(struct grid *g){
+  int placed=0;
+  for(int k=0; k<CELLS; k++){
+    if(g->cell[k]!=0){
+      continue;
+    }
+    unsigned cand=candidates(g, k);
+    if(cand==0){
+      return -1;
+    }
+    if((cand & (cand-1))==0){
+      place(g, k, cand);
+      placed++;
+    }
+  }
+  return placed;
+}
+
+//fills every cell that is the only place left for a digit in one of its
+//groups.  Returns -1 if a digit has nowhere to go, and otherwise the number
+//of cells filled
+static int hidden_singles(struct grid *g){
+  int placed=0;
+  for(int i=0; i<GROUPS; i++){
+    unsigned once=0, twice=0;
+    for(int j=0; j<9; j++){
+      int k=cells_of[i][j];
+      if(g->cell[k]==0){
+        unsigned cand=candidates(g, k);
+        twice|=once & cand;
+        once|=cand;
+      }
+    }
+    if((once | g->used[i])!=ALL_DIGITS){
+      return -1;
+    }
+    unsigned hidden=once & ~twice;
+    while(hidden!=0){
+      unsigned bit=hidden & -hidden;
+      hidden&=hidden-1;
+      //an earlier single in this group may have taken the only cell
+      int j=0;
+      while(j<9 && (g->cell[cells_of[i][j]]!=0 ||
+        !(candidates(g, cells_of[i][j]) & bit))){
+        j++;
+      }
+      if(j==9){
+        return -1;
+      }
+      place(g, cells_of[i][j], bit);
+      placed++;
+    }
+  }
+  return placed;
+}
+
+//applies both kinds of single until neither finds anything.  Returns 0 if
+//the board turned out to have no solution and 1 otherwise
+static int propagate(struct grid *g){
+  for(;;){
+    int naked=naked_singles(g);
+    if(naked<0){
+      return 0;
+    }
+    if(g->filled==CELLS){
+      return 1;
+    }
+    int hidden=hidden_singles(g);
+    if(hidden<0){
+      return 0;
+    }
+    if(naked==0 && hidden==0){
+      return 1;
+    }
+  }
+}
+
+//returns the empty cell with the fewest candidates, storing them in *cand
+static int most_constrained(const struct grid *g, unsigned *cand){
+  int best=-1, best_count=10;
+  for(int k=0; k<CELLS && best_count>2; k++){
+    if(g->cell[k]==0){
+      unsigned c=candidates(g, k);
+      int count=__builtin_popcount(c);
+      if(count<best_count){
+        best=k;
+        best_count=count;
+        *cand=c;
+      }
+    }
+  }
+  return best;
+}
+
+Sudosolve_T Sudosolve_new(void){
+  pthread_once(&tables_once, build_tables);
+  Sudosolve_T solver;
+  NEW(solver);
+  solver->nodes=0;
+  return solver;
+}
+
+//loads the board into g, returning 0 if two givens clash
+static int load(struct grid *g, UArray2_T sudoku){
+  for(int i=0; i<GROUPS; i++){
+    g->used[i]=0;
+  }
+  g->filled=0;
+  UArray2_view view=UArray2_view_of(sudoku);
+  for(int k=0; k<CELLS; k++){
+    unsigned value=*(unsigned *)UArray2_view_at(&view, k%9, k/9);
+    assert(value<10);
+    g->cell[k]=0;
+    if(value!=0){
+      unsigned bit=1u<<(value-1);
+      if(!(candidates(g, k) & bit)){
+        return 0;
+      }
+      place(g, k, bit);
+    }
+  }
+  return 1;
+}
+
+int Sudosolve_board(Sudosolve_T solver, UArray2_T sudoku){
+  assert(solver!=NULL && sudoku!=NULL);
+  assert(UArray2_Columns(sudoku)==9 && UArray2_Rows(sudoku)==9);
+  struct frame *stack=solver->stack;
+  solver->nodes=1;
+  if(!load(&stack[0].grid, sudoku) || !propagate(&stack[0].grid)){
+    return 0;
+  }
+  int depth=0;
+  int descended=1; //set when stack[depth] is a new board to branch on
+  while(depth>=0){
+    struct frame *f=&stack[depth];
+    if(descended){
+      if(f->grid.filled==CELLS){
+        UArray2_view view=UArray2_view_of(sudoku);
+        for(int k=0; k<CELLS; k++){
+          *(unsigned *)UArray2_view_at(&view, k%9, k/9)=f->grid.cell[k];
+        }
+        return 1;
+      }
+      f->cell=most_constrained(&f->grid, &f->untried);
+      descended=0;
+    }
+    if(f->untried==0){
+      depth--;
+      continue;
+    }
+    unsigned bit=f->untried & -f->untried;
+    f->untried&=f->untried-1;
+    solver->nodes++;
+    struct grid *next=&stack[depth+1].grid;
+    *next=f->grid;
+    place(next, f->cell, bit);
+    if(propagate(next)){
+      depth++;
+      descended=1;
+    }
+  }
+  return 0;
+}
+
+long Sudosolve_nodes(Sudosolve_T solver){
+  assert(solver!=NULL);
+  return solver->nodes;
+}
+
+void Sudosolve_free(Sudosolve_T *solver){
+  assert(solver!=NULL && *solver!=NULL);
+  FREE(*solver);
+}
@@ -0,0 +1,61 @@
+/*************************************************
+Sudoku Solver
+Spencer Meldrum and Tim Alander
+
+This interface completes partially filled sudoku boards.  A board is the
+same 9x9 UArray2_T of unsigneds that sudoku checks, with a 0 in every empty
+cell.  The solver keeps the digits used by each row, column and box as 9-bit
+masks, so the candidates for a cell are whatever none of its three groups has
+used yet.
+
+After every guess the solver fills in naked singles (cells with one
+candidate left) and hidden singles (digits with only one possible cell left
+in a row, column or box) until neither finds anything.  It then guesses on
+the empty cell with the fewest candidates and backtracks when a guess leads
+to a cell or digit with no place to go.  Every level of the search is a copy
+of the board kept in a fixed stack inside the Sudosolve_T, so solving does
+not allocate.
+*************************************************/
+
+#ifndef SUDOSOLVE_INCLUDED
+#define SUDOSOLVE_INCLUDED
+
+#include "uarray2.h"
+
+typedef struct Sudosolve_T *Sudosolve_T;
+
+/*************************************************
+Function: Sudosolve_new
+Arguments: none
+Purpose: This function allocates a solver, including room for the deepest
+possible search, so that it can be reused for any number of boards.
+*************************************************/
+Sudosolve_T Sudosolve_new(void);
+
+/*************************************************
+Function: Sudosolve_board
+Arguments: A solver and a 9x9 UArray2_T of unsigneds from 0 to 9
+Purpose: This function fills in every 0 in the board so that it becomes a
+solved sudoku.  It returns 1 on success.  If the givens clash or the board
+has no solution it returns 0 and leaves the board as it was.  It is a c.r.e
+for the board not to be 9x9 or for a cell to be larger than 9.
+*************************************************/
+int Sudosolve_board(Sudosolve_T solver, UArray2_T sudoku);
+
+/*************************************************
+Function: Sudosolve_nodes
+Arguments: A solver
+Purpose: This function returns the number of search nodes the last call to
+Sudosolve_board visited: one for the starting board plus one for every
+guess tried.  A board solved by propagation alone takes a single node.
+*************************************************/
+long Sudosolve_nodes(Sudosolve_T solver);
+
+/*************************************************
+Function: Sudosolve_free
+Arguments: A pointer to a solver
+Purpose: This function frees the solver and sets *solver to NULL.
+*************************************************/
+void Sudosolve_free(Sudosolve_T *solver);
+
+#endif
@@ -1,13 +1,22 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "mem.h"
 #include "assert.h"
 #include "uarray2.h"
 
+// the recursive transpose copies directly once a piece is this many
+// elements (or fewer) on each side
+#define TRANSPOSE_LEAF 16
+// the tiled column-major map buffers this many bytes of every row at once
+#define BAND_BYTES 64
+
 struct UArray2_T {
   UArray_T Linear_Array; // Linear representation of the 2D array
   int array_Rows; // will be set by UArray2_new
   int array_Columns; // will be set by UArray2_new
+  int element_Size; // will be set by UArray2_new
+  char *first_Element; // cached so access does not go through UArray_at
 };
 
 
@@ -16,6 +25,9 @@ UArray2_T UArray2_new(int columns, int rows, int size){
   newArray->Linear_Array=UArray_new(columns*rows, size);
   newArray->array_Rows=rows;
   newArray->array_Columns=columns;
+  newArray->element_Size=size;
+  newArray->first_Element=columns*rows>0 ?
+    UArray_at(newArray->Linear_Array, 0) : NULL;
   return newArray;
 }
 
@@ -23,9 +35,21 @@ void* UArray2_at(UArray2_T t, int column, int row){
   assert(t!=NULL);
   int temp_column=t->array_Columns; // temporary variable to store total number
   // of columns in the array provided
+  assert(column>=0 && column<temp_column && row>=0 && row<t->array_Rows);
   
   // converts 2D coordinate into linear index and returns value
-  return UArray_at(t->Linear_Array,row*temp_column+column);
+  return t->first_Element+((size_t)row*temp_column+column)*t->element_Size;
+}
+
+
+UArray2_view UArray2_view_of(UArray2_T t){
+  assert(t!=NULL);
+  UArray2_view view;
+  view.base=t->first_Element;
+  view.columns=t->array_Columns;
+  view.rows=t->array_Rows;
+  view.size=t->element_Size;
+  return view;
 }
 
 
@@ -54,9 +78,10 @@ void UArray2_map_column_major(UArray2_T t, void apply(void* element, void* cl),
   assert(t!=NULL);
   int max_Row=(t->array_Rows);
   int max_Column=(t->array_Columns);
+  UArray2_view view=UArray2_view_of(t);
   for(int i=0; i<max_Column; i++){
     for(int k=0;k<max_Row; k++){
-      apply(UArray2_at(t, i, k), cl);
+      apply(UArray2_view_at(&view, i, k), cl);
     }
   }
   (void)cl;
@@ -64,11 +89,135 @@ void UArray2_map_column_major(UArray2_T t, void apply(void* element, void* cl),
 }
 
 
+// copies a small rows x columns block into its transpose.  The element size
+// is passed as a constant for the common sizes, so each copy becomes a
+// single move instead of a call to memcpy
+#define TRANSPOSE_LEAF_COPY(SIZE) \
+  for(int k=0; k<rows; k++){ \
+    const char *in=from+k*from_Stride; \
+    char *out=to+(size_t)k*(SIZE); \
+    for(int i=0; i<columns; i++){ \
+      memcpy(out, in, (SIZE)); \
+      in+=(SIZE); \
+      out+=to_Stride; \
+    } \
+  }
+
+
+static void transpose_leaf(const char *from, size_t from_Stride, char *to,
+  size_t to_Stride, int rows, int columns, int size){
+  switch(size){
+  case 1: TRANSPOSE_LEAF_COPY(1) break;
+  case 2: TRANSPOSE_LEAF_COPY(2) break;
+  case 4: TRANSPOSE_LEAF_COPY(4) break;
+  case 8: TRANSPOSE_LEAF_COPY(8) break;
+  case 12: TRANSPOSE_LEAF_COPY(12) break; // a Pnm_rgb
+  default: TRANSPOSE_LEAF_COPY(size) break;
+  }
+}
+
+
+// transposes the rows x columns block at from into the columns x rows block
+// at to.  Strides are the bytes from one row of a block to the next
+static void transpose_block(const char *from, size_t from_Stride, char *to,
+  size_t to_Stride, int rows, int columns, int size){
+  if(rows<=TRANSPOSE_LEAF && columns<=TRANSPOSE_LEAF){
+    transpose_leaf(from, from_Stride, to, to_Stride, rows, columns, size);
+  } else if(rows>=columns){
+    // the top rows become the left columns of the destination
+    int half=rows/2;
+    transpose_block(from, from_Stride, to, to_Stride, half, columns, size);
+    transpose_block(from+half*from_Stride, from_Stride,
+      to+(size_t)half*size, to_Stride, rows-half, columns, size);
+  } else {
+    // the left columns become the top rows of the destination
+    int half=columns/2;
+    transpose_block(from, from_Stride, to, to_Stride, rows, half, size);
+    transpose_block(from+(size_t)half*size, from_Stride,
+      to+half*to_Stride, to_Stride, rows, columns-half, size);
+  }
+}
+
+
+void UArray2_transpose(UArray2_T source, UArray2_T destination){
+  assert(source!=NULL && destination!=NULL);
+  assert(destination->array_Columns==source->array_Rows);
+  assert(destination->array_Rows==source->array_Columns);
+  assert(destination->element_Size==source->element_Size);
+  int size=source->element_Size;
+  transpose_block(source->first_Element,
+    (size_t)source->array_Columns*size, destination->first_Element,
+    (size_t)destination->array_Columns*size, source->array_Rows,
+    source->array_Columns, size);
+}
+
+
+void UArray2_map_column_major_tiled(UArray2_T t, void apply(void* element,
+void* cl), void *cl){
+  assert(t!=NULL);
+  int rows=t->array_Rows;
+  int columns=t->array_Columns;
+  int size=t->element_Size;
+  if(rows==0 || columns==0){
+    return;
+  }
+  int band=BAND_BYTES/size>0 ? BAND_BYTES/size : 1;
+  if(band>columns){
+    band=columns;
+  }
+  size_t row_Bytes=(size_t)columns*size;
+  // buffered columns are padded by a cache line so that a power-of-two
+  // height does not put every column in the same cache sets
+  size_t column_Bytes=(size_t)rows*size+BAND_BYTES;
+  char *buffer=ALLOC(band*column_Bytes);
+  for(int first=0; first<columns; first+=band){
+    int width=columns-first<band ? columns-first : band;
+    char *start=t->first_Element+(size_t)first*size;
+    // each buffered column is contiguous, so apply walks memory in order
+    transpose_block(start, row_Bytes, buffer, column_Bytes, rows, width,
+      size);
+    for(int i=0; i<width; i++){
+      char *element=buffer+i*column_Bytes;
+      for(int k=0; k<rows; k++){
+        apply(element, cl);
+        element+=size;
+      }
+    }
+    transpose_block(buffer, column_Bytes, start, row_Bytes, width, rows,
+      size);
+  }
+  FREE(buffer);
+}
+
+
 void UArray2_map_row_major(UArray2_T t, void apply(void* element, void* cl),
 void *cl){
   assert(t!=NULL);
-  for(int i=0; i<UArray2_length(t); i++){
-    apply(UArray_at(t->Linear_Array, i), cl);
+  int length=UArray2_length(t); // fixed for the life of the array
+  char *element=t->first_Element;
+  for(int i=0; i<length; i++){
+    apply(element, cl);
+    element+=t->element_Size;
+  }
+}
+
+
+void *UArray2_row(UArray2_T t, int row, int *length){
+  assert(t!=NULL);
+  assert(row>=0 && row<t->array_Rows);
+  if(length!=NULL){
+    *length=t->array_Columns;
+  }
+  return t->first_Element+(size_t)row*t->array_Columns*t->element_Size;
+}
+
+
+void UArray2_map_rows(UArray2_T t, void apply(int row, void *elements,
+int count, void *cl), void *cl){
+  assert(t!=NULL);
+  size_t row_Bytes=(size_t)t->array_Columns*t->element_Size;
+  for(int k=0; k<t->array_Rows; k++){
+    apply(k, t->first_Element+k*row_Bytes, t->array_Columns, cl);
   }
 }
 
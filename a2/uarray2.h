@@ -13,15 +13,31 @@ third column, two rows down.
 
 Our interface is an abstraction built upon UArray_T which is provided in
 Hanson's C Libraries.
+
+UArray2_at is a function call that always checks its indices.  Code that
+touches every element can instead take a UArray2_view, which caches the
+address of the first element, the row length and the element size, and use
+UArray2_view_at.  That is inlined into the caller and is a multiply and an
+add.  It checks its indices too, unless the program is compiled with
+-DUARRAY2_UNCHECKED.
 ***********************************************/
 
 #ifndef UARRAY2_T_INCLUDED
 #define UARRAY2_T_INCLUDED
 
+#include <stddef.h>
+#include "assert.h"
 #include "uarray.h"
 
 typedef struct UArray2_T *UArray2_T;
 
+typedef struct UArray2_view{
+  char *base; //the element at column 0, row 0, or NULL if there are none
+  int columns;
+  int rows;
+  int size;
+} UArray2_view;
+
 /***********************************************
 Function: UArray2_new
 Arguments: 3 integers: columns and rows (when multiplied) represent the total
@@ -83,6 +99,37 @@ void UArray2_map_column_major(UArray2_T t, void apply(void* element, void* cl),
 void *cl);
 
 
+/***********************************************
+Function: UArray2_map_column_major_tiled
+Arguments: -A pointer to a UArray_T
+-An apply function
+-A pointer to a closure element
+Purpose: This function visits the elements in exactly the same order as
+UArray2_map_column_major, but much faster on arrays bigger than the cache.
+It copies a band of columns (one cache line of each row) into a buffer laid
+out column by column, calls apply on the buffered copies and then copies the
+band back.  Changes apply makes to its element are kept, but apply must not
+reach the array's other elements any other way while mapping.
+***********************************************/
+void UArray2_map_column_major_tiled(UArray2_T t, void apply(void* element,
+void* cl), void *cl);
+
+
+/***********************************************
+Function: UArray2_transpose
+Arguments: -A pointer to the source UArray2_T
+-A pointer to the destination UArray2_T
+Purpose: This function copies the element at (column, row) of the source
+to (row, column) of the destination.  It splits the larger dimension in
+half recursively until the pieces are small, so at some level of the
+recursion both halves fit in each level of cache, whatever its size.  It
+is a c.r.e for the destination not to have as many columns as the source
+has rows and as many rows as it has columns, or for the element sizes to
+differ.
+***********************************************/
+void UArray2_transpose(UArray2_T source, UArray2_T destination);
+
+
 /***********************************************
 Function: UArray2_map_row_major
 Arguments: -A pointer to a UArray_T
@@ -94,6 +141,62 @@ array provided. The column indices will vary more quickly than the row indices.
 void UArray2_map_row_major(UArray2_T t, void apply(void* element, void* cl),
 void *cl);
 
+/***********************************************
+Function: UArray2_row
+Arguments: -A pointer to a UArray2_T
+-A row index
+-A pointer to an integer, which may be NULL
+Purpose: This function returns a pointer to the first element of the given
+row.  The elements of a row are contiguous, so element i of the row is at
+that pointer plus i times the element size.  If length is not NULL the
+number of elements in the row is stored there.  It is a c.r.e for the row
+to be out of bounds.
+***********************************************/
+void *UArray2_row(UArray2_T t, int row, int *length);
+
+
+/***********************************************
+Function: UArray2_map_rows
+Arguments: -A pointer to a UArray2_T
+-An apply function
+-A pointer to a closure element
+Purpose: This function calls the apply function once per row, from the top
+row down, with the row index, a pointer to the row's contiguous elements and
+how many there are.  Doing a whole row per call lets apply run a plain loop
+over memory, which the compiler can unroll or vectorise, instead of taking
+one call per element.
+***********************************************/
+void UArray2_map_rows(UArray2_T t, void apply(int row, void *elements,
+int count, void *cl), void *cl);
+
+
+/***********************************************
+Function: UArray2_view_of
+Arguments: A pointer to a UArray2_T
+Purpose: This function returns a view of the array for UArray2_view_at.
+The view stays good until the array is freed.
+***********************************************/
+UArray2_view UArray2_view_of(UArray2_T t);
+
+
+/***********************************************
+Function: UArray2_view_at
+Arguments: -A pointer to a view of an array.
+- column and row indices that correspond to a data element within the array.
+Purpose: This function returns a pointer to the data element at the column
+and row indices supplied, just like UArray2_at but without a function call.
+Unless UARRAY2_UNCHECKED is defined it is a c.r.e for the indices to be out
+of bounds.
+***********************************************/
+static inline void *UArray2_view_at(const UArray2_view *v, int column,
+  int row){
+#ifndef UARRAY2_UNCHECKED
+  assert(column>=0 && column<v->columns && row>=0 && row<v->rows);
+#endif
+  return v->base + ((size_t)row*v->columns + column)*v->size;
+}
+
+
 /***********************************************
 Function: UArray2_free
 Arguments: -A pointer to a UArray_T
@@ -6,218 +6,266 @@ This program takes in as input a pbm file that has "black edges" from copying
 errors.  The program then moves this data into a Bit array and cleans up all
 black pixels on the edge as well as all "chains" of black pixels that are
 connected to the edge.  It will print to stdout the modified pbm file without
-any black edges.
+any black edges, as a raw (P4) pbm by default or as a plain (P1) pbm when
+given -plain.  With -threads N the edges are removed by N worker threads
+(N=0 means one per processor) instead of the single-threaded scanline fill.
+
+With -batch N, or -files LIST to read the file names from LIST ("-" for
+stdin), the files are cleaned N at a time (N=0 means one per processor) and
+a file that cannot be read is reported and skipped instead of ending the run.
+The output is the same as cleaning the files one after another.
 *************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
-#include "seq.h"
+#include <string.h>
 #include "pnm.h"
-#include "pnmrdr.h"
 #include "assert.h"
 #include "bit2.h"
-//this struct is how we store the locations of the black bits we need to
-//turn white in our stack.  As we pop them off, we turn their respective
-//indexes in the bit vector from black to white and then call their
-//neighbors
+#include "pnmio.h"
+#include "edgefill.h"
+#include "edgelabel.h"
+#include "batch.h"
+//rows are moved between files and the bit vector this many bytes at a time
+#define CHUNK_BYTES (1<<20)
+//everything needed to clean one image.  It is kept from image to image, so
+//a run over many files reuses the same bit vector, fill stack and row buffer
 typedef struct {
-  int row;
-  int column;
-} bit_loc;
-/*************************************************
-Function:load_bitmap
-Arguments: A FILE pointer that points to the image that will be parsed.
-Purpose: This function will load a pnm reader to parse the pbm, assert that
-it is a pbm, and transfer all the bits to a newly allocated bit vector.  It
-will return a pointer to that new vector
-*************************************************/
-Bit2_T load_bitmap(FILE* fp);
+  Edgefill_T fill;
+  Bit2_T bitmap; //reshaped to fit each image in turn
+  unsigned char *packed; //a chunk of packed rows on their way in or out
+  size_t packed_size;
+} unblacker;
+//the command line options that change how a file is cleaned
+typedef struct {
+  int plain; //1 to print a plain (P1) pbm instead of a raw (P4) one
+  int nthreads; //threads for one image, 1 for the scanline fill
+} unblack_options;
 /*************************************************
-Function: print_bitmap_values
-Arguments: A pointer to our bit vector, width/height of the given value to be
-printed, and a closure argument
-Purpose: This is the apply function that map row major will call when we have
-fixed all of the black edges in our bit vector.  It will print out bit by
-bit what we have stored in our bit vector
+Function: unblacker_new
+Arguments: none
+Purpose: This function allocates the reusable state for cleaning images.  It
+is also the setup function batch workers call, one per thread.
 *************************************************/
-static void print_bitmap_values(Bit2_T bitmap, int width, int height, void* cl);
+static void *unblacker_new(void *cl);
 /*************************************************
-Function: set_bitmap_values
-Arguments: pointer to a bit vector, 2 ints: width and height of a given index 
-in the bit vector, and a closure argument
-Purpose: This apply function will be called by map row major to set all the
-values of the pbm to the values in our bit vector.
+Function: unblacker_free
+Arguments: The state from unblacker_new and a closure argument
+Purpose: This function frees everything unblacker_new allocated.
 *************************************************/
-static void set_bitmap_values(Bit2_T bitmap, int width, int height, void* cl);
+static void unblacker_free(void *state, void *cl);
 /*************************************************
-Function:load_blackedge_sequence
-Arguments: pointer to a bit vector
-Purpose: This will line up our stack to perform all the necessary procedures
-to remove black edges by pushing onto the stack all coordinates of edge bits 
-that are black.  Therefore, when we pop off these edge coordinates, we will 
-have a chain of events that will lead to the complete elimination of black edges
+Function:read_bitmap
+Arguments: A FILE pointer that points to the image that will be parsed, and
+the state to read it into
+Purpose: This function will parse the pbm header, check that it is a pbm,
+and transfer all the bits into the state's bit vector a chunk of packed rows
+at a time.  It returns NULL on success and an error message otherwise.
 *************************************************/
-Seq_T load_blackedge_sequence(Bit2_T bitmap);
+static const char *read_bitmap(FILE *fp, unblacker *u);
 /*************************************************
-Function: remove_black
-Arguments: pointer to a bit vector, pointer to a sequence
-Purpose: This will be the function that pseudo-recursively pushes and pops
-black bits from our bit vector to eliminate the edges.  This function will
-always turn a black bit white when it is popped off, and then call
-push_if_valid_loc to determine if any of its neiboring bits are also black
-edges.
+Function: write_bitmap
+Arguments: The state holding our bit vector, the FILE to write it to, and a
+flag that is 1 for plain (P1) output and 0 for raw (P4) output
+Purpose: This function is called once we have fixed all of the black edges in
+our bit vector.  It prints the pbm header and then packs the rows into a large
+buffer, writing the buffer out whenever it fills up.  It returns NULL on
+success and an error message otherwise.
 *************************************************/
-void remove_black(Bit2_T bitmap, Seq_T stack);
+static const char *write_bitmap(unblacker *u, FILE *fp, int plain);
 /*************************************************
-Function:push_if_valid_loc
-Arguments:pointer to a bit vector, column/row of a specific index in the array
-and a pointer to a sequence
-Purpose: This function will first check if a column/row pair is a legitimate
-value in the bitmap, and if so, it will check if it is a black edge that will
-need to be pushed on the stack via a struct of coordinates representing where
-it is held in the bit vector.
+Function: unblack_file
+Arguments: A FILE pointer to a pbm, the FILE to print the result to, the
+state to clean it with and the options to clean it with
+Purpose: This function loads one pbm, removes its black edges and prints the
+result.  One thread uses the scanline fill, more than one uses
+Edgelabel_clear_edges.  It returns NULL on success and an error message
+otherwise.
 *************************************************/
-void push_if_valid_loc(Bit2_T bitmap, int temp_col, int temp_row, Seq_T stack);
+static const char *unblack_file(FILE *in, FILE *out, unblacker *u,
+  const unblack_options *options);
 /*************************************************
-Function:print_pbm_formatting
-Arguments: none
-Purpose: This is a function that prints the necessary pre-bit printing
-prefixes of "P1" and the width/height of the pbm file.  If it does not
-print this out first, it will not recognize the bits and thus not print out
-certain pbms.
+Function: unblack_job
+Arguments: The state of a batch worker, the name of the file, the input and
+output files, where to put an error message, and the options as a closure
+Purpose: This is the job that Batch_run calls for every file in batch mode.
 *************************************************/
-void print_pbm_formatting();
+static int unblack_job(void *state, const char *path, FILE *in, FILE *out,
+  const char **error, void *cl);
 
 int main(int argc, char *argv[]) {
-  if (argc == 1) {
-    Bit2_T bit_array=load_bitmap(stdin);
-    Seq_T stack=load_blackedge_sequence(bit_array);
-    remove_black(bit_array,stack);
-    print_pbm_formatting(Bit2_width(bit_array), Bit2_height(bit_array));
-    Bit2_map_row_major(bit_array, print_bitmap_values, NULL);
-    Seq_free(&stack);
-    Bit2_free(bit_array);
+  unblack_options options={ 0, 1 };
+  int batch_threads=-1; //-1 unless batch mode was asked for
+  const char *list=NULL;
+  int i=1;
+  for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++) {
+    if (!strcmp(argv[i], "-plain")) {
+      options.plain=1;
+    } else if (!strcmp(argv[i], "-threads") && i + 1 < argc) {
+      options.nthreads=Batch_threads(Batch_parse_threads(argv[0],
+        argv[++i]));
+    } else if (!strcmp(argv[i], "-batch") && i + 1 < argc) {
+      batch_threads=Batch_parse_threads(argv[0], argv[++i]);
+    } else if (!strcmp(argv[i], "-files") && i + 1 < argc) {
+      list=argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [-plain] [-threads N] [-batch N] "
+        "[-files LIST] [filename...]\n", argv[0]);
+      exit(1);
+    }
+  }
+  if (list != NULL || batch_threads >= 0) {
+    char **paths=argv + i;
+    int npaths=argc - i;
+    if (list != NULL) {
+      paths=Batch_open_list(argv[0], list, &npaths);
+    }
+    int failures=Batch_run(argv[0], paths, npaths,
+      Batch_threads(batch_threads),
+      unblacker_new, unblack_job, unblacker_free, &options);
+    if (list != NULL) {
+      Batch_free_list(paths, npaths);
+    }
+    return failures == 0 ? 0 : 1;
+  }
+  unblacker *u=unblacker_new(NULL);
+  if (i == argc) {
+    const char *error=unblack_file(stdin, stdout, u, &options);
+    if (error != NULL) {
+      fprintf(stderr, "%s: %s\n", argv[0], error);
+      exit(1);
+    }
   } else {
-    for (int i = 1; i < argc; i++) {
+    for (; i < argc; i++) {
       FILE *fp = fopen(argv[i], "r");
       if (fp == NULL) {
         fprintf(stderr, "%s: Could not open file %s for reading\n",
         argv[0], argv[i]);
         exit(1);
       }
-      Bit2_T bit_array=load_bitmap(fp);
-      Seq_T stack=load_blackedge_sequence(bit_array);
-      remove_black(bit_array,stack);
-      print_pbm_formatting(Bit2_width(bit_array), Bit2_height(bit_array));
-      Bit2_map_row_major(bit_array, print_bitmap_values, NULL);
-      Seq_free(&stack);
-      Bit2_free(bit_array);
+      const char *error=unblack_file(fp, stdout, u, &options);
+      if (error != NULL) {
+        fprintf(stderr, "%s: %s: %s\n", argv[0], argv[i], error);
+        exit(1);
+      }
+      fclose(fp);
     }
   }
+  unblacker_free(u, NULL);
   return 0;
 }
 
-Bit2_T load_bitmap(FILE* fp){
-  Pnmrdr_T image=Pnmrdr_new(fp);
-  Pnmrdr_mapdata data=Pnmrdr_data(image);
-  assert(data.type==1);
-  int width=data.width;
-  int height=data.height;
-  Bit2_T bitmap=Bit2_new(width, height);
-  Bit2_map_row_major(bitmap, set_bitmap_values, image);
-  Pnmrdr_free(&image);
-  return bitmap;
+//the number of rows of row_bytes bytes that fit in a chunk, at least one and
+//never more than the image has
+static int rows_per_chunk(int row_bytes, int height){
+  int chunk_rows=CHUNK_BYTES/row_bytes;
+  if(chunk_rows<1){ chunk_rows=1; }
+  if(chunk_rows>height){ chunk_rows=height; }
+  return chunk_rows;
 }
 
-static void set_bitmap_values(Bit2_T bitmap, int width, int height, void* cl){
-  Pnmrdr_T image_file=(Pnmrdr_T)cl;
-  unsigned temp=Pnmrdr_get(image_file);
-  assert(temp<2);
-  Bit2_put(bitmap, width, height, temp);
+//makes sure the row buffer holds at least bytes bytes
+static int reserve_packed(unblacker *u, size_t bytes){
+  if(bytes>u->packed_size){
+    unsigned char *bigger=realloc(u->packed, bytes);
+    if(bigger==NULL){
+      return 0;
+    }
+    u->packed=bigger;
+    u->packed_size=bytes;
+  }
+  return 1;
 }
 
-static void print_bitmap_values(Bit2_T bitmap, int width, int height, void *cl){
+static void *unblacker_new(void *cl){
   (void)cl;
-  int temp=Bit2_get(bitmap, width, height);
-  printf("%i", temp);
-  if(width+1==Bit2_width(bitmap)){
-    printf("\n");
+  unblacker *u=malloc(sizeof(*u));
+  assert(u!=NULL);
+  u->fill=Edgefill_new();
+  u->bitmap=Bit2_new(0, 0);
+  u->packed=NULL;
+  u->packed_size=0;
+  return u;
+}
+
+static void unblacker_free(void *state, void *cl){
+  (void)cl;
+  unblacker *u=state;
+  Edgefill_free(&u->fill);
+  Bit2_free(u->bitmap);
+  free(u->packed);
+  free(u);
+}
+
+static const char *unblack_file(FILE *in, FILE *out, unblacker *u,
+  const unblack_options *options){
+  const char *error=read_bitmap(in, u);
+  if(error!=NULL){
+    return error;
+  }
+  if(options->nthreads>1){
+    Edgelabel_clear_edges(u->bitmap, options->nthreads);
+  } else {
+    Edgefill_clear_edges(u->fill, u->bitmap);
   }
+  return write_bitmap(u, out, options->plain);
 }
 
-Seq_T load_blackedge_sequence(Bit2_T bitmap){
-  Seq_T temp=Seq_new(Bit2_size(bitmap));
-  int width=Bit2_width(bitmap);
-  int height=Bit2_height(bitmap);
-  //these are the 4 edges of our bit vector.  Placing all of the black bits
-  //on the stack makes it very easy to manipulate the stack and the touching
-  //inner black edges 
-  for(int i=0; i<width-1; i++){
-    if(Bit2_get(bitmap, i, 0)==1){
-      bit_loc* coords=malloc(sizeof(bit_loc));
-      coords->row=0;
-      coords->column=i;
-      Seq_addhi(temp, coords);
-    }
+static int unblack_job(void *state, const char *path, FILE *in, FILE *out,
+  const char **error, void *cl){
+  (void)path;
+  *error=unblack_file(in, out, state, cl);
+  return *error!=NULL;
+}
+
+static const char *read_bitmap(FILE *fp, unblacker *u){
+  Pnmio_header header;
+  if(!Pnmio_read_header(fp, &header) || header.type!=1){
+    return "not a pbm file";
   }
-  for(int i=0; i<height-1; i++){
-    if(Bit2_get(bitmap, width-1, i)==1){
-      bit_loc* coords=malloc(sizeof(bit_loc));
-      coords->row=i;
-      coords->column=width-1;
-      Seq_addhi(temp, coords);
-    }
+  Bit2_reshape(u->bitmap, header.width, header.height);
+  int row_bytes=Bit2_packed_row_bytes(u->bitmap);
+  if(row_bytes==0 || header.height==0){
+    return NULL;
   }
-  for(int i=width-1; i>0; i--){
-    if(Bit2_get(bitmap, i, height-1)==1){
-      bit_loc* coords=malloc(sizeof(bit_loc));
-      coords->row=height-1;
-      coords->column=i;
-      Seq_addhi(temp, coords);
-    }
+  //a whole chunk of rows goes from the file into the bit vector per pass,
+  //so a raw pbm costs one fread and one copy instead of a call per pixel
+  int chunk_rows=rows_per_chunk(row_bytes, header.height);
+  if(!reserve_packed(u, (size_t)chunk_rows*row_bytes)){
+    return "out of memory";
   }
-  for(int i=height-1; i>0; i--){
-    if(Bit2_get(bitmap, 0, i)==1){
-      bit_loc* coords=malloc(sizeof(bit_loc));
-      coords->row=i;
-      coords->column=0;
-      Seq_addhi(temp, coords);
+  for(int row=0; row<header.height; row+=chunk_rows){
+    int nrows=header.height-row;
+    if(nrows>chunk_rows){ nrows=chunk_rows; }
+    if(!Pnmio_read_bit_rows(fp, &header, nrows, u->packed)){
+      return "pbm file is truncated or holds bad pixels";
     }
+    Bit2_from_packed_rows(u->bitmap, row, nrows, u->packed);
   }
-  return temp;
+  return NULL;
 }
 
-void remove_black(Bit2_T bitmap, Seq_T stack){
-  while(Seq_length(stack)!=0){
-    bit_loc* temp_loc=(bit_loc*)Seq_remhi(stack);
-    if(Bit2_get(bitmap, temp_loc->column, temp_loc->row)==0){
-      free(temp_loc);
-    } else {
-      Bit2_put(bitmap, temp_loc->column, temp_loc->row, 0);
-      //this now calls all the potential new black edges, tests to see if
-      //they are valid, and then will push them onto the stack accordingly
-      push_if_valid_loc(bitmap, temp_loc->column+1, temp_loc->row, stack);
-      push_if_valid_loc(bitmap, temp_loc->column-1, temp_loc->row, stack);
-      push_if_valid_loc(bitmap, temp_loc->column, temp_loc->row+1, stack);
-      push_if_valid_loc(bitmap, temp_loc->column, temp_loc->row-1, stack);
-      free(temp_loc);
-    }
+static const char *write_bitmap(unblacker *u, FILE *fp, int plain){
+  Bit2_T bitmap=u->bitmap;
+  Pnmio_header header={ 1, !plain, Bit2_width(bitmap), Bit2_height(bitmap), 1 };
+  if(!Pnmio_write_header(fp, &header)){
+    return "could not write output";
   }
-}
-
-void push_if_valid_loc(Bit2_T bitmap, int temp_col, int temp_row, Seq_T stack){
-  if(temp_col>=0 && temp_col<Bit2_width(bitmap) && temp_row>=0 && 
-    temp_row<Bit2_height(bitmap)){
-    if(Bit2_get(bitmap, temp_col, temp_row)==1){
-      bit_loc* coords=malloc(sizeof(bit_loc));
-      coords->row=temp_row;
-      coords->column=temp_col;
-      Seq_addhi(stack, coords);
+  int row_bytes=Bit2_packed_row_bytes(bitmap);
+  if(row_bytes==0 || header.height==0){
+    return NULL;
+  }
+  int chunk_rows=rows_per_chunk(row_bytes, header.height);
+  if(!reserve_packed(u, (size_t)chunk_rows*row_bytes)){
+    return "out of memory";
+  }
+  for(int row=0; row<header.height; row+=chunk_rows){
+    int nrows=header.height-row;
+    if(nrows>chunk_rows){ nrows=chunk_rows; }
+    Bit2_to_packed_rows(bitmap, row, nrows, u->packed);
+    if(!Pnmio_write_bit_rows(fp, &header, nrows, u->packed)){
+      return "could not write output";
     }
   }
-}
-
-void print_pbm_formatting(int width, int height){
-  printf("P1\n");
-  printf("%i %i\n", width, height);
+  return NULL;
 }
@@ -0,0 +1,398 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "assert.h"
+#include "a2methods.h"
+#include "a2plain.h"
+#include "a2blocked.h"
+#include "a2zorder.h"
+#include "transpose.h"
+
+// a2bench times every A2Methods suite at a range of array and element
+// sizes and prints one CSV row per measurement:
+//
+//   suite,benchmark,element_bytes,width,height,array_bytes,ns_per_element
+//
+// The suites ending in _sized are the versions returned by for_size, which
+// are the general suites at sizes they have no version for.
+//
+// The benchmarks are random access through at, every mapping function the
+// suite has, and a copy and a 90-degree rotation into a second array.  The
+// pseudo-suite "transpose" times each transpose kernel the CPU can run
+// (the benchmark column names the kernel) rotating plain row-major pixels
+// tile by tile as ppmtrans does, at pixel sizes of 3, 4 and 12 bytes.
+// Each is repeated until it has run for MIN_RUN_NS, and the best of TRIALS
+// runs is reported, so rows can be compared between builds.
+//
+// Usage: a2bench [-max megabytes] [-suite name] [-bench name]
+//
+// Array sizes go up by a factor of 4 from MIN_ARRAY_BYTES to -max
+// (DEFAULT_MAX_MB by default; several thousand for multi-GB arrays).  The
+// copy and the rotation need a second array of the same size.
+
+#define MIN_ARRAY_BYTES (4 * 1024)
+#define DEFAULT_MAX_MB 256
+#define MIN_RUN_NS 10e6
+#define TRIALS 3
+
+typedef A2Methods_UArray2 A2;
+
+static struct suite {
+  const char *name;
+  A2Methods_T *methods; // a pointer, since the suites are not constants
+  int sized;            // use the suite's version for each element size
+} suites[] = {
+  { "plain",         &uarray2_methods_plain,   0 },
+  { "plain_sized",   &uarray2_methods_plain,   1 },
+  { "blocked",       &uarray2_methods_blocked, 0 },
+  { "blocked_sized", &uarray2_methods_blocked, 1 },
+  { "zorder",        &uarray2_methods_zorder,  0 },
+};
+
+static const int element_sizes[] = { 1, 4, 12, 64 };
+static const int pixel_sizes[] = { 3, 4, 12 };
+
+// the transpose kernels rotate tiles that fit in this many bytes together
+// with their destination, as in ppmtrans
+#define TILE_BYTES (32 * 1024)
+
+volatile unsigned sink; // keeps results from being optimized away
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// everything a benchmark needs
+struct bench_state {
+  A2Methods_T methods;
+  A2 source;
+  A2 destination; // width and height swapped, for the rotation
+  int width, height, size;
+  unsigned sum;
+};
+
+// a benchmark runs once over the whole array
+typedef void benchfun(struct bench_state *b);
+
+static void touch(int i, int j, A2 array2, void *elem, void *cl) {
+  (void)i;
+  (void)j;
+  (void)array2;
+  struct bench_state *b = cl;
+  b->sum += *(unsigned char *)elem;
+}
+
+static void small_touch(void *elem, void *cl) {
+  struct bench_state *b = cl;
+  b->sum += *(unsigned char *)elem;
+}
+
+static void span_touch(int i, int j, A2 array2, void *first, int count,
+                       void *cl) {
+  (void)i;
+  (void)j;
+  (void)array2;
+  struct bench_state *b = cl;
+  int size = b->size;
+  for (int k = 0; k < count; k++)
+    b->sum += ((unsigned char *)first)[k * size];
+}
+
+static void copy_element(int i, int j, A2 array2, void *elem, void *cl) {
+  (void)array2;
+  struct bench_state *b = cl;
+  memcpy(b->methods->at(b->destination, i, j), elem, b->size);
+}
+
+// the rotation of ppmtrans: (i, j) goes to (height - 1 - j, i)
+static void rotate_element(int i, int j, A2 array2, void *elem, void *cl) {
+  (void)array2;
+  struct bench_state *b = cl;
+  memcpy(b->methods->at(b->destination, b->height - 1 - j, i), elem,
+         b->size);
+}
+
+static void bench_at_random(struct bench_state *b) {
+  uint64_t x = 88172645463325252ULL;
+  long n = (long)b->width * b->height;
+  for (long k = 0; k < n; k++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    int i = (x & 0xFFFFFFFF) % b->width;
+    int j = (x >> 32) % b->height;
+    b->sum += *(unsigned char *)b->methods->at(b->source, i, j);
+  }
+}
+
+#define MAP_BENCH(MAP) \
+  static void bench_##MAP(struct bench_state *b) { \
+    b->methods->MAP(b->source, touch, b); \
+  }
+MAP_BENCH(map_row_major)
+MAP_BENCH(map_col_major)
+MAP_BENCH(map_block_major)
+MAP_BENCH(map_default)
+
+#define SMALL_MAP_BENCH(MAP) \
+  static void bench_##MAP(struct bench_state *b) { \
+    b->methods->MAP(b->source, small_touch, b); \
+  }
+SMALL_MAP_BENCH(small_map_row_major)
+SMALL_MAP_BENCH(small_map_col_major)
+SMALL_MAP_BENCH(small_map_block_major)
+SMALL_MAP_BENCH(small_map_default)
+
+#define SPAN_MAP_BENCH(MAP) \
+  static void bench_##MAP(struct bench_state *b) { \
+    b->methods->MAP(b->source, span_touch, b); \
+  }
+SPAN_MAP_BENCH(map_spans_row_major)
+SPAN_MAP_BENCH(map_spans_block_major)
+
+// parallel maps call apply from several threads at once, so it reads the
+// element into a local rather than adding to the shared sum
+static void parallel_touch(int i, int j, A2 array2, void *elem, void *cl) {
+  (void)i;
+  (void)j;
+  (void)array2;
+  (void)cl;
+  volatile unsigned char byte = *(unsigned char *)elem;
+  (void)byte;
+}
+
+#define PARALLEL_MAP_BENCH(MAP) \
+  static void bench_##MAP(struct bench_state *b) { \
+    b->methods->MAP(b->source, parallel_touch, b, 0); \
+  }
+PARALLEL_MAP_BENCH(map_row_major_parallel)
+PARALLEL_MAP_BENCH(map_block_major_parallel)
+
+static void bench_copy(struct bench_state *b) {
+  b->methods->map_default(b->source, copy_element, b);
+}
+
+static void bench_rotate90(struct bench_state *b) {
+  b->methods->map_default(b->source, rotate_element, b);
+}
+
+// a benchmark, and where in A2Methods_T the function it needs is, so that
+// suites without that function skip it
+static struct benchmark {
+  const char *name;
+  benchfun *run;
+  size_t member; // offset of the method it needs
+} benchmarks[] = {
+#define NEEDS(MEMBER) offsetof(struct A2Methods_T, MEMBER)
+  { "at_random",                bench_at_random,     NEEDS(at) },
+  { "map_row_major",            bench_map_row_major, NEEDS(map_row_major) },
+  { "map_col_major",            bench_map_col_major, NEEDS(map_col_major) },
+  { "map_block_major",          bench_map_block_major,
+                                NEEDS(map_block_major) },
+  { "map_default",              bench_map_default,   NEEDS(map_default) },
+  { "small_map_row_major",      bench_small_map_row_major,
+                                NEEDS(small_map_row_major) },
+  { "small_map_col_major",      bench_small_map_col_major,
+                                NEEDS(small_map_col_major) },
+  { "small_map_block_major",    bench_small_map_block_major,
+                                NEEDS(small_map_block_major) },
+  { "small_map_default",        bench_small_map_default,
+                                NEEDS(small_map_default) },
+  { "map_spans_row_major",      bench_map_spans_row_major,
+                                NEEDS(map_spans_row_major) },
+  { "map_spans_block_major",    bench_map_spans_block_major,
+                                NEEDS(map_spans_block_major) },
+  { "map_row_major_parallel",   bench_map_row_major_parallel,
+                                NEEDS(map_row_major_parallel) },
+  { "map_block_major_parallel", bench_map_block_major_parallel,
+                                NEEDS(map_block_major_parallel) },
+  { "copy",                     bench_copy,          NEEDS(map_default) },
+  { "rotate90",                 bench_rotate90,      NEEDS(map_default) },
+#undef NEEDS
+};
+
+#define NELEMS(A) (sizeof (A) / sizeof (A)[0])
+
+static int has_method(A2Methods_T methods, size_t member) {
+  void (*method)(void); // every member is a function pointer
+  memcpy(&method, (const char *)methods + member, sizeof method);
+  return method != NULL;
+}
+
+// the best time in ns per element of TRIALS runs, each of enough repeats
+// to take MIN_RUN_NS
+static double time_bench(benchfun *run, struct bench_state *b) {
+  run(b); // warm up, and fault in the destination's pages
+  long repeats = 1;
+  for (;;) {
+    double start = now();
+    for (long r = 0; r < repeats; r++)
+      run(b);
+    if (now() - start >= MIN_RUN_NS)
+      break;
+    repeats *= 2;
+  }
+  double best = 0;
+  for (int t = 0; t < TRIALS; t++) {
+    double start = now();
+    for (long r = 0; r < repeats; r++)
+      run(b);
+    double ns = (now() - start) / repeats;
+    if (t == 0 || ns < best)
+      best = ns;
+  }
+  return best / ((double)b->width * b->height);
+}
+
+static void fill(int i, int j, A2 array2, void *elem, void *cl) {
+  (void)array2;
+  int *size = cl;
+  memset(elem, (i * 31 + j) & 0xFF, *size);
+}
+
+static void run_suite(const struct suite *s, double max_bytes,
+                      const char *only_bench) {
+  A2Methods_T general = *s->methods;
+  assert(general);
+  for (size_t e = 0; e < NELEMS(element_sizes); e++) {
+    int size = element_sizes[e];
+    A2Methods_T methods = s->sized ? general->for_size(size) : general;
+    for (double bytes = MIN_ARRAY_BYTES; bytes <= max_bytes; bytes *= 4) {
+      int side = 1;
+      while ((double)(side + 1) * (side + 1) * size <= bytes)
+        side++;
+      struct bench_state b = { methods, methods->new(side, side, size),
+                               methods->new(side, side, size), side, side,
+                               size, 0 };
+      methods->map_default(b.source, fill, &size);
+      for (size_t k = 0; k < NELEMS(benchmarks); k++) {
+        const struct benchmark *bm = &benchmarks[k];
+        if (!has_method(methods, bm->member))
+          continue;
+        if (only_bench != NULL && strcmp(only_bench, bm->name))
+          continue;
+        double ns = time_bench(bm->run, &b);
+        printf("%s,%s,%d,%d,%d,%.0f,%.3f\n", s->name, bm->name, size,
+               side, side, (double)side * side * size, ns);
+        fflush(stdout);
+      }
+      sink += b.sum;
+      methods->free(&b.source);
+      methods->free(&b.destination);
+    }
+  }
+}
+
+// the state of a transpose kernel benchmark: a side x side source and
+// destination of plain row-major pixels
+struct transpose_state {
+  unsigned char *source;
+  unsigned char *destination;
+  int side, size;
+  int tile; // side of a tile in pixels
+};
+
+// rotates the source 90 degrees, a tile at a time: the tile is read bottom
+// row first so that the rotation is a transpose
+static void rotate_tiles(struct transpose_state *ts) {
+  int side = ts->side;
+  int tile = ts->tile;
+  ptrdiff_t pitch = (ptrdiff_t)side * ts->size;
+  for (int tj = 0; tj < side; tj += tile) {
+    int rows = side - tj < tile ? side - tj : tile;
+    for (int ti = 0; ti < side; ti += tile) {
+      int columns = side - ti < tile ? side - ti : tile;
+      int last = tj + rows - 1;
+      Transpose_block(ts->source + last * pitch + (ptrdiff_t)ti * ts->size,
+                      -pitch,
+                      ts->destination + ti * pitch
+                      + (ptrdiff_t)(side - 1 - last) * ts->size,
+                      pitch, columns, rows, ts->size);
+    }
+  }
+}
+
+static void run_transpose(double max_bytes, const char *only_bench) {
+  for (size_t e = 0; e < NELEMS(pixel_sizes); e++) {
+    int size = pixel_sizes[e];
+    for (double bytes = MIN_ARRAY_BYTES; bytes <= max_bytes; bytes *= 4) {
+      int side = 1;
+      while ((double)(side + 1) * (side + 1) * size <= bytes)
+        side++;
+      size_t length = (size_t)side * side * size;
+      int tile = 1;
+      while (2 * (tile + 1) * (tile + 1) * size <= TILE_BYTES)
+        tile++;
+      struct transpose_state ts = { malloc(length), malloc(length), side,
+                                    size, tile };
+      unsigned char *expected = malloc(length);
+      assert(ts.source && ts.destination && expected);
+      for (size_t k = 0; k < length; k++)
+        ts.source[k] = k * 31 + k / 7;
+      Transpose_set_kernel(TRANSPOSE_SCALAR);
+      rotate_tiles(&ts);
+      memcpy(expected, ts.destination, length);
+      for (int kernel = 0; kernel < TRANSPOSE_KERNELS; kernel++) {
+        const char *name = Transpose_name(kernel);
+        if (!Transpose_set_kernel(kernel))
+          continue;
+        if (only_bench != NULL && strcmp(only_bench, name))
+          continue;
+        memset(ts.destination, 0, length);
+        rotate_tiles(&ts);
+        assert(!memcmp(ts.destination, expected, length));
+        double start = now();
+        long repeats = 0;
+        double best = 0;
+        do {
+          double t0 = now();
+          rotate_tiles(&ts);
+          double ns = now() - t0;
+          if (repeats == 0 || ns < best)
+            best = ns;
+          repeats++;
+        } while (repeats < TRIALS || now() - start < MIN_RUN_NS);
+        printf("transpose,%s,%d,%d,%d,%.0f,%.3f\n", name, size, side,
+               side, (double)length, best / ((double)side * side));
+        fflush(stdout);
+      }
+      free(expected);
+      free(ts.source);
+      free(ts.destination);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  double max_mb = DEFAULT_MAX_MB;
+  const char *only_suite = NULL;
+  const char *only_bench = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-max") && i + 1 < argc) {
+      max_mb = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-suite") && i + 1 < argc) {
+      only_suite = argv[++i];
+    } else if (!strcmp(argv[i], "-bench") && i + 1 < argc) {
+      only_bench = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [-max megabytes] [-suite name] "
+              "[-bench name]\n", argv[0]);
+      exit(1);
+    }
+  }
+  printf("suite,benchmark,element_bytes,width,height,array_bytes,"
+         "ns_per_element\n");
+  for (size_t k = 0; k < NELEMS(suites); k++)
+    if (only_suite == NULL || !strcmp(only_suite, suites[k].name))
+      run_suite(&suites[k], max_mb * 1024 * 1024, only_bench);
+  if (only_suite == NULL || !strcmp(only_suite, "transpose"))
+    run_transpose(max_mb * 1024 * 1024, only_bench);
+  return 0;
+}
@@ -1,14 +1,19 @@
 #include <string.h>
 
+#include "a2methods.h" // our extended copy, before the course header
 #include <a2blocked.h>
 #include "uarray2b.h"
+#include "blocktune.h"
+#include "workpool.h"
 
 // define a private version of each function in A2Methods_T that we implement
 
 typedef A2Methods_UArray2 A2; // private abbreviation
 
+// the blocksize comes from the tuning policy in blocktune.h rather than
+// always filling 64KB, since the best size depends on the host's caches
 static A2 new(int width, int height, int size) {
-  return UArray2b_new_64K_block(width, height, size);
+  return UArray2b_new(width, height, size, Blocktune_blocksize(size));
 }
 
 static A2 new_with_blocksize(int width, int height, int size, int blocksize) {
@@ -34,6 +39,24 @@ static void map_block_major (A2 array2, A2Methods_applyfun apply, void *cl) {
   UArray2b_map(array2, (applyfun*)apply, cl);
 }
 
+struct parallel_closure {
+  UArray2b_T array2b;
+  applyfun *apply;
+  void *cl;
+};
+
+static void map_one_block(int block, void *vcl) {
+  struct parallel_closure *cl = vcl;
+  UArray2b_map_block(cl->array2b, block, cl->apply, cl->cl);
+}
+
+// every block is a task for the work pool
+static void map_block_major_parallel(A2 array2, A2Methods_applyfun apply,
+                                     void *cl, int nthreads) {
+  struct parallel_closure mycl = { array2, (applyfun*)apply, cl };
+  Workpool_run(UArray2b_blocks(array2), nthreads, map_one_block, &mycl);
+}
+
 struct small_closure {
   A2Methods_smallapplyfun *apply; 
   void *cl;
@@ -52,6 +75,25 @@ static void small_map_block_major(A2 a2, A2Methods_smallapplyfun apply, void *cl
   UArray2b_map(a2, apply_small, &mycl);
 }
 
+struct span_closure {
+  A2Methods_spanfun *apply;
+  void *cl;
+  A2 array2;
+};
+
+static void apply_span(int i, int j, void *elements, int count, void *vcl) {
+  struct span_closure *cl = vcl;
+  cl->apply(i, j, cl->array2, elements, count, cl->cl);
+}
+
+static void map_spans_block_major(A2 array2, A2Methods_spanfun apply,
+                                  void *cl) {
+  struct span_closure mycl = { apply, cl, array2 };
+  UArray2b_map_spans(array2, apply_span, &mycl);
+}
+
+static A2Methods_T for_size(int size);
+
 static struct A2Methods_T uarray2_methods_blocked_struct = {
   new,
   new_with_blocksize,
@@ -69,8 +111,123 @@ static struct A2Methods_T uarray2_methods_blocked_struct = {
   NULL, // small_map_col_major
   small_map_block_major,
   small_map_block_major, // small_map_default
+  NULL, // map_row_major_parallel
+  map_block_major_parallel,
+  NULL, // map_spans_row_major
+  map_spans_block_major,
+  map_spans_block_major, // map_spans_default
+  for_size,
 };
 
+// The suites for particular element sizes, built as in a2plain.c: each
+// function below is called with a constant size and inlined into the
+// generated functions, and reads the array's layout in place rather than
+// calling into uarray2b.c
+
+static inline A2Methods_Object *sized_at(A2 array2, int i, int j, int size)
+{
+  const UArray2b_view *v = UArray2b_view_ref(array2);
+  assert(v->size == size);
+  assert(i >= 0 && i < v->width && j >= 0 && j < v->height);
+  int bs = v->blocksize;
+  size_t block = (size_t)(j / bs) * v->blocks_Wide + i / bs;
+  size_t cell = (size_t)(j % bs) * bs + i % bs;
+  return v->cells + block * v->block_Bytes + cell * size;
+}
+
+// visits the elements in the order of UArray2b_map, calling apply, or
+// small_apply if apply is NULL
+static inline void sized_map_block_major(A2 array2, A2Methods_applyfun apply,
+                                         A2Methods_smallapplyfun small_apply,
+                                         void *cl, int size) {
+  const UArray2b_view *v = UArray2b_view_ref(array2);
+  assert(v->size == size);
+  int bs = v->blocksize;
+  char *first = v->cells;
+  for (int bj = 0; bj < v->height; bj += bs) {
+    int rows = v->height - bj < bs ? v->height - bj : bs;
+    for (int bi = 0; bi < v->width; bi += bs, first += v->block_Bytes) {
+      int columns = v->width - bi < bs ? v->width - bi : bs;
+      for (int y = 0; y < rows; y++) {
+        char *elem = first + (size_t)y * bs * size;
+        for (int x = 0; x < columns; x++, elem += size) {
+          if (apply != NULL)
+            apply(bi + x, bj + y, array2, elem, cl);
+          else
+            small_apply(elem, cl);
+        }
+      }
+    }
+  }
+}
+
+// generates the blocked suite for one size; its new takes the blocksize
+// Blocktune chooses for that size
+#define SIZED_SUITE(SIZE) \
+  static A2 new_##SIZE(int width, int height, int size) { \
+    assert(size == (SIZE)); \
+    return UArray2b_new(width, height, (SIZE), \
+                        Blocktune_blocksize((SIZE))); \
+  } \
+  static A2 new_with_blocksize_##SIZE(int width, int height, int size, \
+                                      int blocksize) { \
+    assert(size == (SIZE)); \
+    return UArray2b_new(width, height, (SIZE), blocksize); \
+  } \
+  static A2Methods_Object *at_##SIZE(A2 array2, int i, int j) { \
+    return sized_at(array2, i, j, (SIZE)); \
+  } \
+  static void map_block_major_##SIZE(A2 array2, A2Methods_applyfun apply, \
+                                     void *cl) { \
+    sized_map_block_major(array2, apply, NULL, cl, (SIZE)); \
+  } \
+  static void small_map_block_major_##SIZE(A2 array2, \
+                                           A2Methods_smallapplyfun apply, \
+                                           void *cl) { \
+    sized_map_block_major(array2, NULL, apply, cl, (SIZE)); \
+  } \
+  static struct A2Methods_T uarray2_methods_blocked_##SIZE##_struct = { \
+    new_##SIZE, \
+    new_with_blocksize_##SIZE, \
+    a2free, \
+    width, \
+    height, \
+    size, \
+    blocksize, \
+    at_##SIZE, \
+    NULL, /* map_row_major */ \
+    NULL, /* map_col_major */ \
+    map_block_major_##SIZE, \
+    map_block_major_##SIZE, /* map_default */ \
+    NULL, /* small_map_row_major */ \
+    NULL, /* small_map_col_major */ \
+    small_map_block_major_##SIZE, \
+    small_map_block_major_##SIZE, /* small_map_default */ \
+    NULL, /* map_row_major_parallel */ \
+    map_block_major_parallel, \
+    NULL, /* map_spans_row_major */ \
+    map_spans_block_major, \
+    map_spans_block_major, /* map_spans_default */ \
+    for_size, \
+  };
+
+SIZED_SUITE(1)
+SIZED_SUITE(2)
+SIZED_SUITE(4)
+SIZED_SUITE(8)
+SIZED_SUITE(12) // a Pnm_rgb
+
+static A2Methods_T for_size(int size) {
+  switch (size) {
+  case 1:  return &uarray2_methods_blocked_1_struct;
+  case 2:  return &uarray2_methods_blocked_2_struct;
+  case 4:  return &uarray2_methods_blocked_4_struct;
+  case 8:  return &uarray2_methods_blocked_8_struct;
+  case 12: return &uarray2_methods_blocked_12_struct;
+  default: return &uarray2_methods_blocked_struct;
+  }
+}
+
 // finally the payoff: here is the exported pointer to the struct
 
 A2Methods_T uarray2_methods_blocked = &uarray2_methods_blocked_struct;
@@ -0,0 +1,99 @@
+#ifndef A2METHODS_INCLUDED
+#define A2METHODS_INCLUDED
+
+// This is the course's A2Methods interface with our own additions at the
+// end of struct A2Methods_T.  The compile script searches this directory
+// first, so this copy is the one everything here is built against, and the
+// original members keep their places so that libraries built against the
+// course's copy (such as Pnm_ppmread) still find them.  Any file that
+// includes a course header which itself includes a2methods.h must include
+// this one first.
+
+#define T A2Methods_UArray2
+typedef void *T;              // an unknown sort of array
+typedef void A2Methods_Object; // an unknown sort of element
+
+// apply functions for the full mapping functions get the coordinates, the
+// array and a pointer to the element
+typedef void A2Methods_applyfun(int i, int j, T array2, A2Methods_Object *ptr,
+                                void *cl);
+typedef void A2Methods_mapfun(T array2, A2Methods_applyfun apply, void *cl);
+
+// apply functions for the small mapping functions get only the element
+typedef void A2Methods_smallapplyfun(A2Methods_Object *ptr, void *cl);
+typedef void A2Methods_smallmapfun(T a2, A2Methods_smallapplyfun f, void *cl);
+
+// A parallel mapping function calls apply on every element exactly once,
+// from nthreads threads (0 for one per online processor).  There is no
+// promised order, and apply runs concurrently with itself, so it must only
+// write to state that belongs to the element it is given.
+typedef void A2Methods_parallel_mapfun(T array2, A2Methods_applyfun apply,
+                                       void *cl, int nthreads);
+
+// A span is a run of count elements that lie next to each other in memory
+// along row j, starting at column i.  Span apply functions get a pointer to
+// the first element, and element k of the run is at
+// (char *)first + k * size(array2)
+typedef void A2Methods_spanfun(int i, int j, T array2, A2Methods_Object *first,
+                               int count, void *cl);
+typedef void A2Methods_spanmapfun(T array2, A2Methods_spanfun apply,
+                                  void *cl);
+
+typedef struct A2Methods_T {
+  // creates a distinct 2D array of memory cells, each of the given size
+  // each cell is uninitialized
+  // if the array is blocked, uses a default block size
+  T (*new)(int width, int height, int size);
+  // creates a distinct 2D array of memory cells, each of the given size
+  // each cell is uninitialized
+  // if the array is blocked, the block size given is a hint
+  T (*new_with_blocksize)(int width, int height, int size, int blocksize);
+
+  void (*free)(T *array2p); // frees the array and sets *array2p to NULL
+
+  // observe properties of the array
+  int (*width)(T array2);
+  int (*height)(T array2);
+  int (*size)(T array2);
+  int (*blocksize)(T array2); // for an unblocked array, returns 1
+
+  // returns a pointer to the object in column i, row j
+  // (checked runtime error if i or j is out of bounds)
+  A2Methods_Object *(*at)(T array2, int i, int j);
+
+  // mapping functions; any may be NULL if the array does not support it
+  A2Methods_mapfun *map_row_major;
+  A2Methods_mapfun *map_col_major;
+  A2Methods_mapfun *map_block_major;
+  A2Methods_mapfun *map_default; // the most efficient of the above
+
+  A2Methods_smallmapfun *small_map_row_major;
+  A2Methods_smallmapfun *small_map_col_major;
+  A2Methods_smallmapfun *small_map_block_major;
+  A2Methods_smallmapfun *small_map_default;
+
+  // our additions start here
+
+  // parallel mapping functions; whole rows or bands of rows in the plain
+  // suite, whole blocks in the blocked suite
+  A2Methods_parallel_mapfun *map_row_major_parallel;
+  A2Methods_parallel_mapfun *map_block_major_parallel;
+
+  // span mapping functions visit the elements in the same order as the
+  // mapping functions above but call apply once per span: a whole row in
+  // the plain suite, one row of a block in the blocked suite
+  A2Methods_spanmapfun *map_spans_row_major;
+  A2Methods_spanmapfun *map_spans_block_major;
+  A2Methods_spanmapfun *map_spans_default;
+
+  // returns a suite for the same arrays whose at and mapping functions are
+  // compiled for elements of the given size, so that every stride in them
+  // is a constant; its new and new_with_blocksize take only that size.  A
+  // suite with no version for the size returns itself.  Functions that do
+  // not touch elements, and the parallel and span maps (whose cost is in
+  // apply), are shared with the general suite
+  struct A2Methods_T *(*for_size)(int size);
+} *A2Methods_T;
+
+#undef T
+#endif
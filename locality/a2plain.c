@@ -0,0 +1,303 @@
+#include <stdlib.h>
+
+#include "a2methods.h" // our extended copy, before the course header
+#include <a2plain.h>
+#include "uarray2.h"
+#include "workpool.h"
+
+// parallel row-major mapping gives each thread about this many bands of
+// rows, so the work pool has something to steal at the end
+#define BANDS_PER_THREAD 8
+
+// define a private version of each function in A2Methods_T that we implement
+
+typedef A2Methods_UArray2 A2; // private abbreviation
+
+static A2 new(int width, int height, int size) {
+  return UArray2_new(width, height, size);
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+  (void) blocksize;
+  return UArray2_new(width, height, size);
+}
+
+static void a2free(A2 *array2p) {
+  UArray2_free(*array2p);
+  *array2p = NULL;
+}
+
+static int width    (A2 array2) { return UArray2_Columns(array2); }
+static int height   (A2 array2) { return UArray2_Rows   (array2); }
+static int blocksize(A2 array2) { (void)array2; return 1; }
+
+static int size(A2 array2) {
+  UArray2_view view = UArray2_view_of(array2);
+  return view.size;
+}
+
+static A2Methods_Object *at(A2 array2, int i, int j) {
+  return UArray2_at(array2, i, j);
+}
+
+// a whole row is contiguous, so row-major mapping steps a pointer along it
+struct row_closure {
+  A2Methods_applyfun *apply;
+  void *cl;
+  A2 array2;
+  int size;
+};
+
+static void apply_row(int row, void *elements, int count, void *vcl) {
+  struct row_closure *cl = vcl;
+  char *elem = elements;
+  for (int i = 0; i < count; i++, elem += cl->size)
+    cl->apply(i, row, cl->array2, elem, cl->cl);
+}
+
+static void map_row_major(A2 array2, A2Methods_applyfun apply, void *cl) {
+  struct row_closure mycl = { apply, cl, array2, size(array2) };
+  UArray2_map_rows(array2, apply_row, &mycl);
+}
+
+struct band_closure {
+  struct row_closure rows;
+  int band_rows; // rows in every band but the last
+};
+
+static void map_band(int band, void *vcl) {
+  struct band_closure *cl = vcl;
+  int first = band * cl->band_rows;
+  int last = first + cl->band_rows;
+  if (last > height(cl->rows.array2))
+    last = height(cl->rows.array2);
+  for (int j = first; j < last; j++) {
+    int count;
+    void *elements = UArray2_row(cl->rows.array2, j, &count);
+    apply_row(j, elements, count, &cl->rows);
+  }
+}
+
+// every band of whole rows is a task for the work pool
+static void map_row_major_parallel(A2 array2, A2Methods_applyfun apply,
+                                   void *cl, int nthreads) {
+  int rows = height(array2);
+  if (rows == 0)
+    return;
+  int bands = Workpool_threads(nthreads) * BANDS_PER_THREAD;
+  struct band_closure mycl = { { apply, cl, array2, size(array2) },
+                               (rows + bands - 1) / bands };
+  Workpool_run((rows + mycl.band_rows - 1) / mycl.band_rows, nthreads,
+               map_band, &mycl);
+}
+
+// a whole row is one span
+struct span_closure {
+  A2Methods_spanfun *apply;
+  void *cl;
+  A2 array2;
+};
+
+static void apply_span(int row, void *elements, int count, void *vcl) {
+  struct span_closure *cl = vcl;
+  cl->apply(0, row, cl->array2, elements, count, cl->cl);
+}
+
+static void map_spans_row_major(A2 array2, A2Methods_spanfun apply,
+                                void *cl) {
+  struct span_closure mycl = { apply, cl, array2 };
+  UArray2_map_rows(array2, apply_span, &mycl);
+}
+
+static void map_col_major(A2 array2, A2Methods_applyfun apply, void *cl) {
+  UArray2_view view = UArray2_view_of(array2);
+  for (int i = 0; i < view.columns; i++)
+    for (int j = 0; j < view.rows; j++)
+      apply(i, j, array2, UArray2_view_at(&view, i, j), cl);
+}
+
+static void small_map_row_major(A2 array2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+  UArray2_map_row_major(array2, apply, cl);
+}
+
+static void small_map_col_major(A2 array2, A2Methods_smallapplyfun apply,
+                                void *cl)
+{
+  UArray2_map_column_major(array2, apply, cl);
+}
+
+// now create the private struct containing pointers to the functions
+
+static A2Methods_T for_size(int size);
+
+static struct A2Methods_T uarray2_methods_plain_struct = {
+  new,
+  new_with_blocksize,
+  a2free,
+  width,
+  height,
+  size,
+  blocksize,
+  at,
+  map_row_major,
+  map_col_major,
+  NULL, // map_block_major
+  map_row_major, // map_default
+  small_map_row_major,
+  small_map_col_major,
+  NULL, // small_map_block_major
+  small_map_row_major, // small_map_default
+  map_row_major_parallel,
+  NULL, // map_block_major_parallel
+  map_spans_row_major,
+  NULL, // map_spans_block_major
+  map_spans_row_major, // map_spans_default
+  for_size,
+};
+
+// The suites for particular element sizes.  Each function below takes the
+// size as an argument and is called with a constant, so once it is inlined
+// into the generated functions every stride and every element address is
+// worked out with a constant size.  at reads the array's view in place
+// rather than calling UArray2_at
+
+static inline A2Methods_Object *sized_at(A2 array2, int i, int j, int size)
+{
+  const UArray2_view *v = UArray2_view_ref(array2);
+  assert(v->size == size);
+  assert(i >= 0 && i < v->columns && j >= 0 && j < v->rows);
+  return v->base + ((size_t)j * v->columns + i) * size;
+}
+
+static inline void sized_map_row_major(A2 array2, A2Methods_applyfun apply,
+                                       void *cl, int size) {
+  const UArray2_view *v = UArray2_view_ref(array2);
+  assert(v->size == size);
+  int columns = v->columns;
+  int rows = v->rows;
+  char *elem = v->base;
+  for (int j = 0; j < rows; j++)
+    for (int i = 0; i < columns; i++, elem += size)
+      apply(i, j, array2, elem, cl);
+}
+
+static inline void sized_map_col_major(A2 array2, A2Methods_applyfun apply,
+                                       void *cl, int size) {
+  const UArray2_view *v = UArray2_view_ref(array2);
+  assert(v->size == size);
+  int columns = v->columns;
+  int rows = v->rows;
+  size_t row_bytes = (size_t)columns * size;
+  for (int i = 0; i < columns; i++) {
+    char *elem = v->base + (size_t)i * size;
+    for (int j = 0; j < rows; j++, elem += row_bytes)
+      apply(i, j, array2, elem, cl);
+  }
+}
+
+static inline void sized_small_map_row_major(A2 array2,
+                                             A2Methods_smallapplyfun apply,
+                                             void *cl, int size) {
+  const UArray2_view *v = UArray2_view_ref(array2);
+  assert(v->size == size);
+  size_t length = (size_t)v->columns * v->rows;
+  char *elem = v->base;
+  for (size_t k = 0; k < length; k++, elem += size)
+    apply(elem, cl);
+}
+
+static inline void sized_small_map_col_major(A2 array2,
+                                             A2Methods_smallapplyfun apply,
+                                             void *cl, int size) {
+  const UArray2_view *v = UArray2_view_ref(array2);
+  assert(v->size == size);
+  int columns = v->columns;
+  int rows = v->rows;
+  size_t row_bytes = (size_t)columns * size;
+  for (int i = 0; i < columns; i++) {
+    char *elem = v->base + (size_t)i * size;
+    for (int j = 0; j < rows; j++, elem += row_bytes)
+      apply(elem, cl);
+  }
+}
+
+// generates the plain suite for one size, with no block-major maps
+#define SIZED_SUITE(SIZE) \
+  static A2 new_##SIZE(int width, int height, int size) { \
+    assert(size == (SIZE)); \
+    return UArray2_new(width, height, (SIZE)); \
+  } \
+  static A2 new_with_blocksize_##SIZE(int width, int height, int size, \
+                                      int blocksize) { \
+    (void)blocksize; \
+    return new_##SIZE(width, height, size); \
+  } \
+  static A2Methods_Object *at_##SIZE(A2 array2, int i, int j) { \
+    return sized_at(array2, i, j, (SIZE)); \
+  } \
+  static void map_row_major_##SIZE(A2 array2, A2Methods_applyfun apply, \
+                                   void *cl) { \
+    sized_map_row_major(array2, apply, cl, (SIZE)); \
+  } \
+  static void map_col_major_##SIZE(A2 array2, A2Methods_applyfun apply, \
+                                   void *cl) { \
+    sized_map_col_major(array2, apply, cl, (SIZE)); \
+  } \
+  static void small_map_row_major_##SIZE(A2 array2, \
+                                         A2Methods_smallapplyfun apply, \
+                                         void *cl) { \
+    sized_small_map_row_major(array2, apply, cl, (SIZE)); \
+  } \
+  static void small_map_col_major_##SIZE(A2 array2, \
+                                         A2Methods_smallapplyfun apply, \
+                                         void *cl) { \
+    sized_small_map_col_major(array2, apply, cl, (SIZE)); \
+  } \
+  static struct A2Methods_T uarray2_methods_plain_##SIZE##_struct = { \
+    new_##SIZE, \
+    new_with_blocksize_##SIZE, \
+    a2free, \
+    width, \
+    height, \
+    size, \
+    blocksize, \
+    at_##SIZE, \
+    map_row_major_##SIZE, \
+    map_col_major_##SIZE, \
+    NULL, /* map_block_major */ \
+    map_row_major_##SIZE, /* map_default */ \
+    small_map_row_major_##SIZE, \
+    small_map_col_major_##SIZE, \
+    NULL, /* small_map_block_major */ \
+    small_map_row_major_##SIZE, /* small_map_default */ \
+    map_row_major_parallel, \
+    NULL, /* map_block_major_parallel */ \
+    map_spans_row_major, \
+    NULL, /* map_spans_block_major */ \
+    map_spans_row_major, /* map_spans_default */ \
+    for_size, \
+  };
+
+SIZED_SUITE(1)
+SIZED_SUITE(2)
+SIZED_SUITE(4)
+SIZED_SUITE(8)
+SIZED_SUITE(12) // a Pnm_rgb
+
+static A2Methods_T for_size(int size) {
+  switch (size) {
+  case 1:  return &uarray2_methods_plain_1_struct;
+  case 2:  return &uarray2_methods_plain_2_struct;
+  case 4:  return &uarray2_methods_plain_4_struct;
+  case 8:  return &uarray2_methods_plain_8_struct;
+  case 12: return &uarray2_methods_plain_12_struct;
+  default: return &uarray2_methods_plain_struct;
+  }
+}
+
+// finally the payoff: here is the exported pointer to the struct
+
+A2Methods_T uarray2_methods_plain = &uarray2_methods_plain_struct;
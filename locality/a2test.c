@@ -4,6 +4,7 @@
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2zorder.h"
 
 
 #define W 13
@@ -30,6 +31,27 @@ static void small_check_and_increment(void *elem, void *cl) {
   *counter += 1;   // NOT *counter++!
 }
 
+static void span_check_and_increment(int i, int j, A2 a, void *first,
+                                     int count, void *cl) {
+  (void)i;
+  (void)j;
+  int *counter = cl;
+  for (int k = 0; k < count; k++) {
+    int *p = (int *)((char *)first + k * methods->size(a));
+    assert(*p == *counter);
+    *counter += 1;
+  }
+}
+
+// every element of a span must be where at says it is
+static void check_span(int i, int j, A2 a, void *first, int count, void *cl) {
+  int *seen = cl;
+  for (int k = 0; k < count; k++)
+    assert((char *)first + k * methods->size(a)
+           == (char *)methods->at(a, i + k, j));
+  *seen += count;
+}
+
 static void double_row_major_plus() {
   // store increasing integers in row-major order
   A2 array = methods->new_with_blocksize(W, H, sizeof(int), BS);
@@ -56,6 +78,15 @@ static void double_row_major_plus() {
     counter = 1;
     methods->small_map_row_major(array, small_check_and_increment, &counter);
   }
+  if (methods->map_spans_row_major) {
+    counter = 1;
+    methods->map_spans_row_major(array, span_check_and_increment, &counter);
+  }
+  if (methods->map_spans_default) {
+    int seen = 0;
+    methods->map_spans_default(array, check_span, &seen);
+    assert(seen == W * H);
+  }
   methods->free(&array);
 }
 
@@ -139,11 +170,24 @@ static void test_methods(A2Methods_T methods_under_test) {
   methods->free(&array);
 }
 
+// a suite with versions for particular sizes has one for the size of an
+// int, which must pass the same tests, and none for an odd size
+static void test_for_size(A2Methods_T general) {
+  A2Methods_T sized = general->for_size(sizeof(unsigned));
+  assert(sized != general);
+  assert(sized->for_size(7) == general);
+  assert(general->for_size(7) == general);
+  test_methods(sized);
+}
+
 int main(int argc, char *argv[]) {
   assert(argc == 1);
   (void)argv;
   test_methods(uarray2_methods_plain);
-  //  test_methods(uarray2_methods_blocked);
+  test_methods(uarray2_methods_blocked);
+  test_methods(uarray2_methods_zorder);
+  test_for_size(uarray2_methods_plain);
+  test_for_size(uarray2_methods_blocked);
   printf("Passed.\n");  // only if we reach this point without assertion failure
   return 0;
 }
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+
+#include "a2zorder.h"
+#include "uarray2z.h"
+
+// define a private version of each function in A2Methods_T that we implement
+
+typedef A2Methods_UArray2 A2; // private abbreviation
+
+static A2 new(int width, int height, int size) {
+  return UArray2z_new(width, height, size);
+}
+
+static A2 new_with_blocksize(int width, int height, int size, int blocksize)
+{
+  (void) blocksize; // Z-order has a block at every size already
+  return UArray2z_new(width, height, size);
+}
+
+static void a2free(A2 *array2p) {
+  UArray2z_free((UArray2z_T *)array2p);
+}
+
+static int width    (A2 array2) { return UArray2z_width (array2); }
+static int height   (A2 array2) { return UArray2z_height(array2); }
+static int size     (A2 array2) { return UArray2z_size  (array2); }
+static int blocksize(A2 array2) { (void)array2; return 1; }
+
+static A2Methods_Object *at(A2 array2, int i, int j) {
+  return UArray2z_at(array2, i, j);
+}
+
+typedef void applyfun(int i, int j, UArray2z_T array2z, void *elem, void *cl);
+
+static void map_zorder(A2 array2, A2Methods_applyfun apply, void *cl) {
+  UArray2z_map(array2, (applyfun*)apply, cl);
+}
+
+// row- and column-major orders jump around in memory; they are here so that
+// code written for those orders still works on Z-order arrays
+static void map_row_major(A2 array2, A2Methods_applyfun apply, void *cl) {
+  int w = width(array2), h = height(array2);
+  for (int j = 0; j < h; j++)
+    for (int i = 0; i < w; i++)
+      apply(i, j, array2, UArray2z_at(array2, i, j), cl);
+}
+
+static void map_col_major(A2 array2, A2Methods_applyfun apply, void *cl) {
+  int w = width(array2), h = height(array2);
+  for (int i = 0; i < w; i++)
+    for (int j = 0; j < h; j++)
+      apply(i, j, array2, UArray2z_at(array2, i, j), cl);
+}
+
+struct small_closure {
+  A2Methods_smallapplyfun *apply;
+  void *cl;
+};
+
+static void apply_small(int i, int j, A2 array2, void *elem, void *vcl) {
+  struct small_closure *cl = vcl;
+  (void)i;
+  (void)j;
+  (void)array2;
+  cl->apply(elem, cl->cl);
+}
+
+static void small_map_zorder(A2 a2, A2Methods_smallapplyfun apply, void *cl) {
+  struct small_closure mycl = { apply, cl };
+  map_zorder(a2, apply_small, &mycl);
+}
+
+static void small_map_row_major(A2 a2, A2Methods_smallapplyfun apply,
+                                void *cl) {
+  struct small_closure mycl = { apply, cl };
+  map_row_major(a2, apply_small, &mycl);
+}
+
+static void small_map_col_major(A2 a2, A2Methods_smallapplyfun apply,
+                                void *cl) {
+  struct small_closure mycl = { apply, cl };
+  map_col_major(a2, apply_small, &mycl);
+}
+
+static A2Methods_T for_size(int size);
+
+static struct A2Methods_T uarray2_methods_zorder_struct = {
+  new,
+  new_with_blocksize,
+  a2free,
+  width,
+  height,
+  size,
+  blocksize,
+  at,
+  map_row_major,
+  map_col_major,
+  NULL, // map_block_major
+  map_zorder, // map_default
+  small_map_row_major,
+  small_map_col_major,
+  NULL, // small_map_block_major
+  small_map_zorder, // small_map_default
+  NULL, // map_row_major_parallel
+  NULL, // map_block_major_parallel
+  // in Z-order no more than two cells of a row are next to each other, so
+  // spans would save nothing
+  NULL, // map_spans_row_major
+  NULL, // map_spans_block_major
+  NULL, // map_spans_default
+  for_size,
+};
+
+// at already works through precomputed tables whatever the size, so there
+// are no versions for particular sizes
+static A2Methods_T for_size(int size) {
+  (void)size;
+  return &uarray2_methods_zorder_struct;
+}
+
+// finally the payoff: here is the exported pointer to the struct
+
+A2Methods_T uarray2_methods_zorder = &uarray2_methods_zorder_struct;
@@ -0,0 +1,9 @@
+#ifndef A2ZORDER_INCLUDED
+#define A2ZORDER_INCLUDED
+#include "a2methods.h"
+
+// the methods for Z-order arrays (UArray2z_T); map_default visits elements
+// in Z-order, which is the order they sit in memory
+extern A2Methods_T uarray2_methods_zorder;
+
+#endif
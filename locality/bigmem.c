@@ -0,0 +1,106 @@
+#define _DEFAULT_SOURCE // for MAP_ANONYMOUS and the Linux madvise advice
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "assert.h"
+#include "except.h"
+#include "mem.h"
+#include "bigmem.h"
+
+#define HUGE_PAGE_BYTES ((size_t)2 * 1024 * 1024)
+
+// -1 until the policy is set or read from the environment
+static int policy = -1;
+
+int Bigmem_pages_named(const char *name, Bigmem_pages *pages) {
+  assert(name != NULL && pages != NULL);
+  if (!strcmp(name, "small"))
+    *pages = BIGMEM_SMALL_PAGES;
+  else if (!strcmp(name, "huge"))
+    *pages = BIGMEM_HUGE_PAGES;
+  else if (!strcmp(name, "hugetlb"))
+    *pages = BIGMEM_HUGETLB;
+  else
+    return 0;
+  return 1;
+}
+
+void Bigmem_set_pages(Bigmem_pages pages) {
+  policy = pages;
+}
+
+Bigmem_pages Bigmem_get_pages(void) {
+  if (policy < 0) {
+    Bigmem_pages pages = BIGMEM_HUGE_PAGES;
+    const char *name = getenv("A2_PAGES");
+    if (name != NULL)
+      Bigmem_pages_named(name, &pages); // an unknown name keeps the default
+    policy = pages;
+  }
+  return policy;
+}
+
+static size_t region_bytes(size_t bytes) {
+  return (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+}
+
+// maps a region of the given size (a multiple of HUGE_PAGE_BYTES) that
+// starts on a huge page, by mapping a huge page more than needed and
+// unmapping the ends
+static void *map_aligned(size_t length) {
+  size_t extra = length + HUGE_PAGE_BYTES;
+  char *p = mmap(NULL, extra, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED)
+    return NULL;
+  uintptr_t start = ((uintptr_t)p + HUGE_PAGE_BYTES - 1)
+                    / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+  char *aligned = (char *)start;
+  if (aligned > p)
+    munmap(p, aligned - p);
+  if (aligned + length < p + extra)
+    munmap(aligned + length, p + extra - (aligned + length));
+  return aligned;
+}
+
+void *Bigmem_alloc(size_t bytes) {
+  if (bytes == 0)
+    return NULL;
+  if (bytes < HUGE_PAGE_BYTES) {
+    void *p;
+    if (posix_memalign(&p, BIGMEM_CACHE_LINE, bytes) != 0)
+      RAISE(Mem_Failed);
+    memset(p, 0, bytes);
+    return p;
+  }
+  size_t length = region_bytes(bytes);
+  Bigmem_pages pages = Bigmem_get_pages();
+#ifdef MAP_HUGETLB
+  if (pages == BIGMEM_HUGETLB) {
+    void *p = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED)
+      return p;
+  }
+#endif
+  void *p = map_aligned(length);
+  if (p == NULL)
+    RAISE(Mem_Failed);
+  // advice the kernel does not know is harmless to leave out
+#if defined(MADV_HUGEPAGE) && defined(MADV_NOHUGEPAGE)
+  madvise(p, length, pages == BIGMEM_SMALL_PAGES ? MADV_NOHUGEPAGE
+                                                 : MADV_HUGEPAGE);
+#endif
+  return p;
+}
+
+void Bigmem_free(void *p, size_t bytes) {
+  if (p == NULL)
+    return;
+  if (bytes < HUGE_PAGE_BYTES)
+    free(p);
+  else
+    munmap(p, region_bytes(bytes));
+}
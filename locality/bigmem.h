@@ -0,0 +1,68 @@
+/***********************************************
+Big Memory
+Spencer Meldrum and Tim Alander
+
+This interface allocates the backing store of large arrays.  Every
+allocation starts on a cache-line boundary.  An allocation of at least one
+huge page (2MB) is its own mmap region, aligned to a huge page, and the
+page policy says how it is backed:
+
+  small   - ordinary pages only, even if the kernel would use huge pages
+  huge    - transparent huge pages, asked for with madvise (the default)
+  hugetlb - pages from the hugetlbfs pool, falling back on transparent
+            huge pages when the pool is empty or not configured
+
+A rotation of a large image touches a new page on almost every step down a
+column, so with small pages the TLB misses as often as the cache does.  The
+policy is there so that the same workload can be timed both ways.
+***********************************************/
+
+#ifndef BIGMEM_INCLUDED
+#define BIGMEM_INCLUDED
+
+#include <stddef.h>
+
+// the alignment every allocation has
+#define BIGMEM_CACHE_LINE 64
+
+typedef enum {
+  BIGMEM_SMALL_PAGES,
+  BIGMEM_HUGE_PAGES,
+  BIGMEM_HUGETLB
+} Bigmem_pages;
+
+/***********************************************
+Function: Bigmem_set_pages, Bigmem_get_pages
+Arguments: a page policy
+Purpose: These functions set and return the policy used by later
+allocations.  Until it is set, the policy is named by $A2_PAGES ("small",
+"huge" or "hugetlb") or is huge.
+***********************************************/
+void Bigmem_set_pages(Bigmem_pages pages);
+Bigmem_pages Bigmem_get_pages(void);
+
+/***********************************************
+Function: Bigmem_pages_named
+Arguments: the name of a policy and a pointer to store it through
+Purpose: This function returns 1 and stores the policy if the name is one
+of "small", "huge" or "hugetlb", and returns 0 otherwise.
+***********************************************/
+int Bigmem_pages_named(const char *name, Bigmem_pages *pages);
+
+/***********************************************
+Function: Bigmem_alloc
+Arguments: a number of bytes
+Purpose: This function returns that many zeroed bytes, aligned as described
+above, or NULL for 0 bytes.  Like ALLOC, it raises Mem_Failed if the memory
+cannot be had.
+***********************************************/
+void *Bigmem_alloc(size_t bytes);
+
+/***********************************************
+Function: Bigmem_free
+Arguments: a pointer from Bigmem_alloc and the size it was allocated with
+Purpose: This function releases the memory.  A NULL pointer is ignored.
+***********************************************/
+void Bigmem_free(void *p, size_t bytes);
+
+#endif
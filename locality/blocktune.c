@@ -0,0 +1,173 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "assert.h"
+#include "uarray2b.h"
+#include "cachesize.h"
+#include "blocktune.h"
+
+// the block footprint to use when nothing better is known
+#define DEFAULT_BLOCK_BYTES (64 * 1024)
+// choices for element sizes up to this are remembered in memory
+#define MAX_REMEMBERED_SIZE 64
+// the calibration rotates an array of about this many elements...
+#define CALIBRATION_ELEMENTS (1024 * 1024)
+// ...but no more than this many bytes
+#define CALIBRATION_BYTES (32 * 1024 * 1024)
+// the smallest block footprint calibration tries
+#define MIN_CALIBRATION_BLOCK_BYTES (4 * 1024)
+// calibration keeps the fastest of this many rotations with each blocksize
+#define CALIBRATION_TRIALS 5
+
+static pthread_mutex_t tune_lock = PTHREAD_MUTEX_INITIALIZER;
+static int remembered[MAX_REMEMBERED_SIZE + 1]; // 0 until chosen
+
+// the side of the largest square block of elements that fits in bytes
+static int side_for(long bytes, int size) {
+  int side = (int)sqrt((double)bytes / size);
+  return side > 0 ? side : 1;
+}
+
+static const char *profile_path(char *buf, int n) {
+  const char *path = getenv("A2BLOCKED_PROFILE");
+  if (path != NULL)
+    return path;
+  const char *home = getenv("HOME");
+  if (home == NULL)
+    return NULL;
+  snprintf(buf, n, "%s/.a2blocked-profile", home);
+  return buf;
+}
+
+// returns the blocksize the profile gives for size on a host with these
+// L1 and L2 sizes, or 0 if it has none; lines for other hosts, which may
+// share the file through a common home directory, are ignored
+static int read_profile(const char *path, int size, long l1, long l2) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL)
+    return 0;
+  int found = 0, element, blocksize;
+  long line_l1, line_l2;
+  char line[128];
+  while (fgets(line, sizeof line, fp) != NULL)
+    if (sscanf(line, "%d %ld %ld %d", &element, &line_l1, &line_l2,
+               &blocksize) == 4
+        && element == size && line_l1 == l1 && line_l2 == l2
+        && blocksize > 0)
+      found = blocksize; // a later line overrides an earlier one
+  fclose(fp);
+  return found;
+}
+
+static void write_profile(const char *path, int size, long l1, long l2,
+                          int blocksize) {
+  FILE *fp = fopen(path, "a");
+  if (fp == NULL)
+    return; // the profile is only a cache, so failing to save is harmless
+  fprintf(fp, "%d %ld %ld %d\n", size, l1, l2, blocksize);
+  fclose(fp);
+}
+
+struct rotation {
+  UArray2b_T destination;
+  int height;
+  int size;
+};
+
+// rotates one element 90 degrees into the destination, the way ppmtrans does
+static void rotate_element(int i, int j, UArray2b_T source, void *elem,
+                           void *cl) {
+  (void)source;
+  struct rotation *r = cl;
+  memcpy(UArray2b_at(r->destination, r->height - 1 - j, i), elem, r->size);
+}
+
+static void touch_element(int i, int j, UArray2b_T array2b, void *elem,
+                          void *cl) {
+  (void)i; (void)j; (void)array2b;
+  memset(elem, 0, *(int *)cl);
+}
+
+static double seconds(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// times a block-major rotation of a test array for block footprints from
+// MIN_CALIBRATION_BLOCK_BYTES up to the size of L2, doubling each time,
+// and returns the blocksize with the fastest of CALIBRATION_TRIALS
+// rotations, so that one run slowed by another process does not decide
+static int calibrate(int size, long l2) {
+  long elements = CALIBRATION_ELEMENTS;
+  if (elements * size > CALIBRATION_BYTES)
+    elements = CALIBRATION_BYTES / size;
+  int side = (int)sqrt((double)elements);
+  if (side < 1)
+    side = 1;
+  long largest = l2 > 0 ? l2 : 16 * DEFAULT_BLOCK_BYTES;
+  int best = side_for(DEFAULT_BLOCK_BYTES, size);
+  double best_time = -1.0;
+  int last = 0;
+  for (long bytes = MIN_CALIBRATION_BLOCK_BYTES; bytes <= largest;
+       bytes *= 2) {
+    int blocksize = side_for(bytes, size);
+    if (blocksize == last)
+      continue;
+    last = blocksize;
+    UArray2b_T source = UArray2b_new(side, side, size, blocksize);
+    UArray2b_T destination = UArray2b_new(side, side, size, blocksize);
+    // fault every page in first so that only the rotation is timed
+    UArray2b_map(source, touch_element, &size);
+    UArray2b_map(destination, touch_element, &size);
+    struct rotation r = { destination, side, size };
+    for (int trial = 0; trial < CALIBRATION_TRIALS; trial++) {
+      double start = seconds();
+      UArray2b_map(source, rotate_element, &r);
+      double elapsed = seconds() - start;
+      if (best_time < 0 || elapsed < best_time) {
+        best_time = elapsed;
+        best = blocksize;
+      }
+    }
+    UArray2b_free(&source);
+    UArray2b_free(&destination);
+  }
+  return best;
+}
+
+// makes the choice described in blocktune.h
+static int choose(int size) {
+  char buf[512];
+  const char *path = profile_path(buf, sizeof buf);
+  long l1 = Cachesize_smallest(1), l2 = Cachesize_smallest(2);
+  if (path != NULL) {
+    int blocksize = read_profile(path, size, l1, l2);
+    if (blocksize > 0)
+      return blocksize;
+  }
+  if (getenv("A2BLOCKED_CALIBRATE") != NULL) {
+    int blocksize = calibrate(size, l2);
+    if (path != NULL)
+      write_profile(path, size, l1, l2, blocksize);
+    return blocksize;
+  }
+  return side_for(l2 > 0 ? l2 / 4 : DEFAULT_BLOCK_BYTES, size);
+}
+
+int Blocktune_blocksize(int size) {
+  assert(size > 0);
+  if (size > MAX_REMEMBERED_SIZE)
+    return choose(size);
+  pthread_mutex_lock(&tune_lock);
+  if (remembered[size] == 0)
+    remembered[size] = choose(size);
+  int blocksize = remembered[size];
+  pthread_mutex_unlock(&tune_lock);
+  return blocksize;
+}
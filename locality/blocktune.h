@@ -0,0 +1,39 @@
+/***********************************************
+Block Size Tuning
+Spencer Meldrum and Tim Alander
+
+This interface picks the blocksize that uarray2_methods_blocked uses when
+the caller does not give one.  The best size depends on the element size and
+on the caches of the machine, so a single 64KB block is right on some hosts
+and 4x off on others.  The choice is made once per element size, in order of
+preference:
+
+1. A blocksize recorded for that element size in the profile file, which is
+   $A2BLOCKED_PROFILE if set and $HOME/.a2blocked-profile otherwise.  Each
+   line of the file is an element size, the L1 and L2 sizes in bytes of the
+   host it was found on, and a blocksize.  A home directory may be shared by
+   different kinds of host, so lines whose cache sizes differ from this
+   host's are ignored.
+2. If $A2BLOCKED_CALIBRATE is set, a short benchmark that rotates a test
+   array several times with each of a few candidate blocksizes and keeps
+   the fastest.  The result is added to the profile so later runs skip the
+   benchmark.
+3. A block of a quarter of the L2 cache, so that a source and a destination
+   block fit in L2 together with room to spare.  This is the smallest L2
+   of any CPU, as cachesize.h finds it.
+4. A 64KB block, if the cache sizes cannot be read.
+***********************************************/
+
+#ifndef BLOCKTUNE_INCLUDED
+#define BLOCKTUNE_INCLUDED
+
+/***********************************************
+Function: Blocktune_blocksize
+Arguments: the size in bytes of one element
+Purpose: This function returns the number of elements along each side of a
+block for arrays of that element size.  It is safe to call from several
+threads at once.
+***********************************************/
+int Blocktune_blocksize(int size);
+
+#endif
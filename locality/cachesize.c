@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cachesize.h"
+
+// reads the first line of a small sysfs file into buf, without the newline
+static int read_line(const char *path, char *buf, int n) {
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL)
+    return 0;
+  int ok = fgets(buf, n, fp) != NULL;
+  fclose(fp);
+  if (ok)
+    buf[strcspn(buf, "\n")] = '\0';
+  return ok;
+}
+
+// parses a sysfs cache size such as "48K" or "2048K"
+static long parse_size(const char *text) {
+  char *end;
+  long n = strtol(text, &end, 10);
+  switch (*end) {
+  case 'K': return n * 1024;
+  case 'M': return n * 1024 * 1024;
+  case 'G': return n * 1024 * 1024 * 1024;
+  default:  return n;
+  }
+}
+
+// the smallest, or with largest set the largest, of two sizes, where 0
+// means not known
+static long pick(long a, long b, int largest) {
+  if (a == 0)
+    return b;
+  if (b == 0)
+    return a;
+  if (largest)
+    return b > a ? b : a;
+  return b < a ? b : a;
+}
+
+// the smallest or largest data or unified cache of one CPU at the given
+// level, or at any level if level is 0; 0 if it has none or is missing
+static long cpu_cache_bytes(long cpu, int level, int largest) {
+  long found = 0;
+  char path[128], text[64];
+  for (int index = 0; index < CACHESIZE_MAX_INDEX; index++) {
+    // an index can be missing with others after it, so none ends the search
+    snprintf(path, sizeof path,
+             "/sys/devices/system/cpu/cpu%ld/cache/index%d/level",
+             cpu, index);
+    if (!read_line(path, text, sizeof text)
+        || (level != 0 && atoi(text) != level))
+      continue;
+    snprintf(path, sizeof path,
+             "/sys/devices/system/cpu/cpu%ld/cache/index%d/type",
+             cpu, index);
+    if (!read_line(path, text, sizeof text)
+        || !strcmp(text, "Instruction"))
+      continue;
+    snprintf(path, sizeof path,
+             "/sys/devices/system/cpu/cpu%ld/cache/index%d/size",
+             cpu, index);
+    if (!read_line(path, text, sizeof text))
+      continue;
+    long bytes = parse_size(text);
+    if (bytes > 0)
+      found = pick(found, bytes, largest);
+  }
+  return found;
+}
+
+// the smallest or largest cache of every present CPU
+static long present_cache_bytes(int level, int largest) {
+  // CPU numbers can have holes where a CPU is offline or missing, so the
+  // CPUs are taken from the kernel's list of present ones, such as
+  // "0-3,6,8-11", rather than counted up from 0
+  char list[1024];
+  long found = 0;
+  if (!read_line("/sys/devices/system/cpu/present", list, sizeof list)) {
+    long n = sysconf(_SC_NPROCESSORS_CONF);
+    for (long cpu = 0; cpu < n; cpu++)
+      found = pick(found, cpu_cache_bytes(cpu, level, largest), largest);
+    return found;
+  }
+  char *p = list;
+  while (*p != '\0') {
+    char *end;
+    long first = strtol(p, &end, 10), last = first;
+    if (end == p)
+      break;
+    if (*end == '-') {
+      p = end + 1;
+      last = strtol(p, &end, 10);
+      if (end == p)
+        break;
+    }
+    for (long cpu = first; cpu <= last; cpu++)
+      found = pick(found, cpu_cache_bytes(cpu, level, largest), largest);
+    p = *end == ',' ? end + 1 : end;
+    if (*end != ',' && *end != '\0')
+      break;
+  }
+  return found;
+}
+
+long Cachesize_smallest(int level) {
+  return present_cache_bytes(level, 0);
+}
+
+long Cachesize_largest(void) {
+  return present_cache_bytes(0, 1);
+}
@@ -0,0 +1,35 @@
+/***********************************************
+Cache Sizes
+Spencer Meldrum and Tim Alander
+
+This interface reads the sizes of the CPU caches from sysfs, under
+/sys/devices/system/cpu/cpu<n>/cache/index<m>.  Only data and unified caches
+count.  Every CPU in the kernel's list of present CPUs is looked at, and
+every index up to CACHESIZE_MAX_INDEX, so a hole in the numbering of either
+does not hide the caches after it.
+***********************************************/
+
+#ifndef CACHESIZE_INCLUDED
+#define CACHESIZE_INCLUDED
+
+// the cache indices looked at for each CPU are 0 up to this, less one
+#define CACHESIZE_MAX_INDEX 16
+
+/***********************************************
+Function: Cachesize_smallest
+Arguments: a cache level (1, 2 or 3)
+Purpose: This function returns the size in bytes of the smallest cache at
+that level on any CPU, or 0 if it cannot be found.
+***********************************************/
+long Cachesize_smallest(int level);
+
+/***********************************************
+Function: Cachesize_largest
+Arguments: none
+Purpose: This function returns the size in bytes of the largest cache at any
+level on any CPU, which is the last level before memory, or 0 if no cache
+can be found.
+***********************************************/
+long Cachesize_largest(void);
+
+#endif
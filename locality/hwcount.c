@@ -0,0 +1,160 @@
+// This file uses only the C library, not CII, so that stride, which is
+// built on its own by compile-stride, can use it too.
+#define _DEFAULT_SOURCE // for syscall
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "hwcount.h"
+
+struct Hwcount_T {
+  int fd[HWCOUNT_EVENTS];       // -1 for a counter that could not be opened
+  double value[HWCOUNT_EVENTS]; // counts from the last region
+  double start_ns;
+  double ns;
+};
+
+static const char *names[HWCOUNT_EVENTS] = {
+  "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses"
+};
+
+const char *Hwcount_name(Hwcount_event event) {
+  assert(event >= 0 && event < HWCOUNT_EVENTS);
+  return names[event];
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#ifdef __linux__
+// a read miss in the given generic cache
+#define CACHE_READ_MISS(CACHE) \
+  ((CACHE) | PERF_COUNT_HW_CACHE_OP_READ << 8 \
+   | PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+
+static int open_counter(Hwcount_event event) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.size = sizeof attr;
+  switch (event) {
+  case HWCOUNT_CYCLES:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    break;
+  case HWCOUNT_INSTRUCTIONS:
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    break;
+  case HWCOUNT_L1D_MISSES:
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D);
+    break;
+  case HWCOUNT_LLC_MISSES:
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL);
+    break;
+  case HWCOUNT_DTLB_MISSES:
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB);
+    break;
+  default:
+    return -1;
+  }
+  attr.disabled = 1;
+  attr.inherit = 1; // count threads started inside the region
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                   | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  return fd < 0 ? -1 : (int)fd;
+}
+#else
+static int open_counter(Hwcount_event event) {
+  (void)event;
+  return -1;
+}
+#endif
+
+Hwcount_T Hwcount_new(void) {
+  Hwcount_T counters = malloc(sizeof *counters);
+  assert(counters);
+  for (int e = 0; e < HWCOUNT_EVENTS; e++) {
+    counters->fd[e] = open_counter(e);
+    counters->value[e] = -1;
+  }
+  counters->start_ns = counters->ns = 0;
+  return counters;
+}
+
+void Hwcount_free(Hwcount_T *counters) {
+  assert(counters != NULL && *counters != NULL);
+  for (int e = 0; e < HWCOUNT_EVENTS; e++)
+    if ((*counters)->fd[e] >= 0)
+      close((*counters)->fd[e]);
+  free(*counters);
+  *counters = NULL;
+}
+
+void Hwcount_start(Hwcount_T counters) {
+  assert(counters != NULL);
+#ifdef __linux__
+  for (int e = 0; e < HWCOUNT_EVENTS; e++) {
+    if (counters->fd[e] >= 0) {
+      ioctl(counters->fd[e], PERF_EVENT_IOC_RESET, 0);
+      ioctl(counters->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+  counters->start_ns = now();
+}
+
+void Hwcount_stop(Hwcount_T counters) {
+  assert(counters != NULL);
+  counters->ns = now() - counters->start_ns;
+#ifdef __linux__
+  for (int e = 0; e < HWCOUNT_EVENTS; e++) {
+    counters->value[e] = -1;
+    if (counters->fd[e] < 0)
+      continue;
+    ioctl(counters->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    // the count, then how long the counter was enabled and how long it
+    // was actually on the CPU
+    uint64_t reading[3];
+    if (read(counters->fd[e], reading, sizeof reading)
+        != (ssize_t)sizeof reading)
+      continue;
+    if (reading[2] == 0)
+      counters->value[e] = 0;
+    else
+      counters->value[e] = (double)reading[0] * reading[1] / reading[2];
+  }
+#endif
+}
+
+int Hwcount_available(Hwcount_T counters, Hwcount_event event) {
+  assert(counters != NULL && event >= 0 && event < HWCOUNT_EVENTS);
+  return counters->fd[event] >= 0;
+}
+
+double Hwcount_value(Hwcount_T counters, Hwcount_event event) {
+  assert(counters != NULL && event >= 0 && event < HWCOUNT_EVENTS);
+  return counters->value[event];
+}
+
+double Hwcount_ns(Hwcount_T counters) {
+  assert(counters != NULL);
+  return counters->ns;
+}
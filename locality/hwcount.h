@@ -0,0 +1,73 @@
+/***********************************************
+Hardware Counters
+Spencer Meldrum and Tim Alander
+
+This interface counts what the CPU does during a measured region: cycles,
+instructions, L1 data cache misses, last-level cache misses and data TLB
+misses, using Linux perf_event_open.  Each counter is opened on its own, so
+one the CPU or kernel does not offer leaves the others working; inside a
+container, or with perf_event_paranoid set high, none may be available,
+and then only the wall time of the region is measured.  Counting covers
+the calling thread and any thread it starts inside the region.
+***********************************************/
+
+#ifndef HWCOUNT_INCLUDED
+#define HWCOUNT_INCLUDED
+
+typedef struct Hwcount_T *Hwcount_T;
+
+typedef enum {
+  HWCOUNT_CYCLES,
+  HWCOUNT_INSTRUCTIONS,
+  HWCOUNT_L1D_MISSES,
+  HWCOUNT_LLC_MISSES,
+  HWCOUNT_DTLB_MISSES,
+  HWCOUNT_EVENTS // the number of events
+} Hwcount_event;
+
+/***********************************************
+Function: Hwcount_new, Hwcount_free
+Arguments: none; a pointer to a Hwcount_T
+Purpose: Hwcount_new opens every counter it can.  Hwcount_free closes them
+and sets *counters to NULL.
+***********************************************/
+Hwcount_T Hwcount_new(void);
+void Hwcount_free(Hwcount_T *counters);
+
+/***********************************************
+Function: Hwcount_start, Hwcount_stop
+Arguments: a Hwcount_T
+Purpose: These functions bracket a measured region.  Hwcount_start zeroes
+the counters and the clock; Hwcount_stop freezes them until the next start.
+***********************************************/
+void Hwcount_start(Hwcount_T counters);
+void Hwcount_stop(Hwcount_T counters);
+
+/***********************************************
+Function: Hwcount_available
+Arguments: a Hwcount_T and an event
+Purpose: This function returns 1 if the event is being counted and 0 if no
+counter for it could be opened.
+***********************************************/
+int Hwcount_available(Hwcount_T counters, Hwcount_event event);
+
+/***********************************************
+Function: Hwcount_value, Hwcount_ns
+Arguments: a Hwcount_T, and an event for Hwcount_value
+Purpose: These functions return the count of an event in the last region,
+or -1 if it is not available, and the region's wall time in nanoseconds.
+A count is scaled up if the kernel had to share the counter with others
+for part of the region.
+***********************************************/
+double Hwcount_value(Hwcount_T counters, Hwcount_event event);
+double Hwcount_ns(Hwcount_T counters);
+
+/***********************************************
+Function: Hwcount_name
+Arguments: an event
+Purpose: This function returns a short name for the event, such as
+"llc_misses", suitable for a column heading.
+***********************************************/
+const char *Hwcount_name(Hwcount_event event);
+
+#endif
@@ -0,0 +1,151 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mem.h"
+#include "assert.h"
+#include "ppmmap.h"
+
+// the longest header Ppmmap_create writes: "P6\n", two numbers and a space,
+// a denominator and two newlines
+#define MAX_HEADER 40
+
+// reads a decimal header field at *pos, after any whitespace and comments.
+// Returns 0 if there is none or it does not fit in an unsigned
+static int header_field(const unsigned char *image, size_t length,
+                        size_t *pos, unsigned *value) {
+  size_t p = *pos;
+  for (;;) {
+    while (p < length && isspace(image[p]))
+      p++;
+    if (p < length && image[p] == '#') {
+      while (p < length && image[p] != '\n')
+        p++;
+    } else {
+      break;
+    }
+  }
+  if (p >= length || !isdigit(image[p]))
+    return 0;
+  unsigned long n = 0;
+  while (p < length && isdigit(image[p])) {
+    n = n * 10 + (image[p++] - '0');
+    if (n > 0xFFFFFFFFUL)
+      return 0;
+  }
+  *value = n;
+  *pos = p;
+  return 1;
+}
+
+// fills in the public fields from the header at the start of ppm->image.
+// Returns 0 unless it is a well-formed raw PPM with all of its pixels
+static int parse_header(Ppmmap ppm) {
+  size_t pos = 2;
+  if (ppm->length < 2 || ppm->image[0] != 'P' || ppm->image[1] != '6')
+    return 0;
+  if (!header_field(ppm->image, ppm->length, &pos, &ppm->width)
+      || !header_field(ppm->image, ppm->length, &pos, &ppm->height)
+      || !header_field(ppm->image, ppm->length, &pos, &ppm->denominator))
+    return 0;
+  // exactly one whitespace character separates the header from the pixels
+  if (pos >= ppm->length || !isspace(ppm->image[pos]))
+    return 0;
+  pos++;
+  if (ppm->denominator == 0 || ppm->denominator > 65535)
+    return 0;
+  ppm->pixel_bytes = ppm->denominator < 256 ? 3 : 6;
+  unsigned long long bytes = (unsigned long long)ppm->width * ppm->height
+                             * ppm->pixel_bytes;
+  if (bytes > ppm->length - pos)
+    return 0;
+  ppm->pixels = ppm->image + pos;
+  return 1;
+}
+
+Ppmmap Ppmmap_read(const char *path) {
+  assert(path != NULL);
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < 2) {
+    close(fd);
+    return NULL;
+  }
+  void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping keeps the file open
+  if (image == MAP_FAILED)
+    return NULL;
+  Ppmmap ppm;
+  NEW0(ppm);
+  ppm->image = image;
+  ppm->length = st.st_size;
+  ppm->mapped = 1;
+  if (!parse_header(ppm)) {
+    Ppmmap_free(&ppm);
+    return NULL;
+  }
+  return ppm;
+}
+
+Ppmmap Ppmmap_create(const char *path, unsigned width, unsigned height,
+                     unsigned denominator) {
+  assert(denominator > 0 && denominator <= 65535);
+  char header[MAX_HEADER];
+  int header_length = snprintf(header, sizeof header, "P6\n%u %u\n%u\n",
+                               width, height, denominator);
+  assert(header_length > 0 && header_length < MAX_HEADER);
+  int pixel_bytes = denominator < 256 ? 3 : 6;
+  size_t length = header_length + (size_t)width * height * pixel_bytes;
+
+  Ppmmap ppm;
+  NEW0(ppm);
+  ppm->length = length;
+  if (path == NULL) {
+    ppm->image = ALLOC(length);
+  } else {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+      FREE(ppm);
+      return NULL;
+    }
+    void *image = MAP_FAILED;
+    if (ftruncate(fd, length) == 0)
+      image = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+      FREE(ppm);
+      return NULL;
+    }
+    ppm->image = image;
+    ppm->mapped = 1;
+  }
+  memcpy(ppm->image, header, header_length);
+  ppm->width = width;
+  ppm->height = height;
+  ppm->denominator = denominator;
+  ppm->pixel_bytes = pixel_bytes;
+  ppm->pixels = ppm->image + header_length;
+  return ppm;
+}
+
+int Ppmmap_write(FILE *fp, Ppmmap ppm) {
+  assert(fp != NULL && ppm != NULL);
+  return fwrite(ppm->image, 1, ppm->length, fp) == ppm->length;
+}
+
+void Ppmmap_free(Ppmmap *ppm) {
+  assert(ppm != NULL && *ppm != NULL);
+  if ((*ppm)->mapped)
+    munmap((*ppm)->image, (*ppm)->length);
+  else
+    FREE((*ppm)->image);
+  FREE(*ppm);
+}
@@ -0,0 +1,72 @@
+/***********************************************
+Mapped Raw PPM Images
+Spencer Meldrum and Tim Alander
+
+This interface gives direct access to the pixels of a raw (P6) PPM file by
+mapping the file into memory, so a program can read the pixels where they
+sit in the page cache instead of parsing them into an array first.  An
+output image can be mapped the same way: its file is made the right size
+up front, and writing a pixel into the map writes it into the file.
+
+Pixels are stored as in the file: row-major, with no padding, three samples
+per pixel, and one byte per sample when the denominator is below 256, two
+big-endian bytes otherwise.
+***********************************************/
+
+#ifndef PPMMAP_INCLUDED
+#define PPMMAP_INCLUDED
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct Ppmmap {
+  unsigned width, height, denominator;
+  int pixel_bytes;       // 3 or 6
+  unsigned char *pixels; // width * height pixels of pixel_bytes each
+
+  // private to the implementation
+  unsigned char *image;  // the header and then the pixels
+  size_t length;         // bytes in image
+  int mapped;            // image is a file mapping rather than allocated
+} *Ppmmap;
+
+/***********************************************
+Function: Ppmmap_read
+Arguments: the name of a file
+Purpose: This function maps the file read-only and finds its pixels.  It
+returns NULL, having changed nothing, if the file cannot be opened, is not
+a regular file (a pipe, say), or does not hold a well-formed raw PPM, so
+that the caller can fall back on reading it some other way.
+***********************************************/
+Ppmmap Ppmmap_read(const char *path);
+
+/***********************************************
+Function: Ppmmap_create
+Arguments: the name of a file (or NULL), and the width, height and
+denominator of an image
+Purpose: This function makes a raw PPM of the given size whose pixels are
+to be filled in by the caller.  With a file name, the file is created or
+truncated, made the size of the image, and mapped, so pixels go straight to
+the file; with NULL the image is kept in memory for Ppmmap_write.  It
+returns NULL if the file cannot be created or mapped.
+***********************************************/
+Ppmmap Ppmmap_create(const char *path, unsigned width, unsigned height,
+                     unsigned denominator);
+
+/***********************************************
+Function: Ppmmap_write
+Arguments: an open file and a Ppmmap
+Purpose: This function writes the whole image, header and pixels, to the
+file.  It returns 0 if the write fails and 1 otherwise.
+***********************************************/
+int Ppmmap_write(FILE *fp, Ppmmap ppm);
+
+/***********************************************
+Function: Ppmmap_free
+Arguments: a pointer to a Ppmmap
+Purpose: This function unmaps or frees the image and sets *ppm to NULL.  An
+image created on a file is in the file once this returns.
+***********************************************/
+void Ppmmap_free(Ppmmap *ppm);
+
+#endif
@@ -1,15 +1,557 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 
 #include "assert.h"
+#include "mem.h"
 #include "a2methods.h"
 #include "a2plain.h"
 #include "a2blocked.h"
+#include "a2zorder.h"
+#include "bigmem.h"
+#include "hwcount.h"
 #include "pnm.h"
+#include "ppmmap.h"
+#include "transpose.h"
+#include "uarray2.h"
+#include "workpool.h"
+
+typedef A2Methods_UArray2 A2;
+
+// the tiled kernel keeps a source tile and a destination tile together in
+// about this many bytes, which is the size of a typical L1 data cache
+#define TILE_BYTES (32 * 1024)
+
+// A transform sends the pixel at (i, j) to
+// (xi * i + xj * j + x0, yi * i + yj * j + y0) in a width x height image.
+// Every rotation, flip and transpose is one of these.
+struct transform {
+  int xi, xj, x0;
+  int yi, yj, y0;
+  int width, height;
+};
+
+// A symmetry is the part of a transform that does not depend on the size
+// of the image: (i, j) goes to (xi * i + xj * j, yi * i + yj * j), and then
+// the image is moved back onto the origin.  There are 8 of them, and any
+// chain of rotations, flips and transposes is one of them, so a chain is
+// composed into a single symmetry before any pixel moves and costs no more
+// than one transform.
+struct symmetry {
+  int xi, xj;
+  int yi, yj;
+};
+
+static const struct symmetry identity = { 1, 0, 0, 1 };
+
+static struct symmetry rotation_symmetry(int degrees) {
+  switch (degrees) {
+  case 90:  return (struct symmetry){ 0, -1,  1,  0 };
+  case 180: return (struct symmetry){ -1, 0,  0, -1 };
+  case 270: return (struct symmetry){ 0,  1, -1,  0 };
+  default:  return identity;
+  }
+}
+
+static struct symmetry flip_symmetry(int horizontal) {
+  if (horizontal)
+    return (struct symmetry){ -1, 0, 0, 1 };
+  else
+    return (struct symmetry){ 1, 0, 0, -1 };
+}
+
+static const struct symmetry transpose_symmetry = { 0, 1, 1, 0 };
+
+// the symmetry that does first and then second
+static struct symmetry compose(struct symmetry first, struct symmetry second)
+{
+  return (struct symmetry){
+    second.xi * first.xi + second.xj * first.yi,
+    second.xi * first.xj + second.xj * first.yj,
+    second.yi * first.xi + second.yj * first.yi,
+    second.yi * first.xj + second.yj * first.yj
+  };
+}
+
+// the transform that applies a symmetry to a w x h image.  A coordinate
+// that counts down from i or j is offset by the largest value of i or j, so
+// that the result starts at 0
+static struct transform placed(struct symmetry s, int w, int h) {
+  int swaps = s.xi == 0; // rows become columns
+  return (struct transform){
+    s.xi, s.xj, (s.xi < 0 ? w - 1 : 0) + (s.xj < 0 ? h - 1 : 0),
+    s.yi, s.yj, (s.yi < 0 ? w - 1 : 0) + (s.yj < 0 ? h - 1 : 0),
+    swaps ? h : w, swaps ? w : h
+  };
+}
+
+static int is_identity(const struct transform *t) {
+  return t->xi == 1 && t->xj == 0 && t->x0 == 0
+      && t->yi == 0 && t->yj == 1 && t->y0 == 0;
+}
+
+struct copy_closure {
+  A2Methods_T methods;
+  A2 destination;
+  struct transform t;
+};
+
+// apply function for the map-driven transform: one pixel per call, in
+// whatever order the chosen mapping function visits the source
+static void copy_pixel(int i, int j, A2 source, void *elem, void *vcl) {
+  (void)source;
+  struct copy_closure *cl = vcl;
+  const struct transform *t = &cl->t;
+  Pnm_rgb to = cl->methods->at(cl->destination,
+                               t->xi * i + t->xj * j + t->x0,
+                               t->yi * i + t->yj * j + t->y0);
+  *to = *(Pnm_rgb)elem;
+}
+
+// apply function for the span-driven transform: one call per run of
+// adjacent source pixels, whose destinations are a step (xi, yi) apart
+static void copy_span(int i, int j, A2 source, void *first, int count,
+                      void *vcl) {
+  (void)source;
+  struct copy_closure *cl = vcl;
+  const struct transform *t = &cl->t;
+  Pnm_rgb from = first;
+  int x = t->xi * i + t->xj * j + t->x0;
+  int y = t->yi * i + t->yj * j + t->y0;
+  for (int k = 0; k < count; k++, x += t->xi, y += t->yi) {
+    Pnm_rgb to = cl->methods->at(cl->destination, x, y);
+    *to = from[k];
+  }
+}
+
+// the side of a square tile such that a source and a destination tile of
+// pixels of the given size fit in TILE_BYTES together
+static int tile_side(int pixel_bytes) {
+  int side = 1;
+  while (2 * (side + 1) * (side + 1) * pixel_bytes <= TILE_BYTES)
+    side++;
+  return side;
+}
+
+// 90, 270 and transpose send the rows of a tile to the columns of the
+// destination, so a tile of row-major pixels is copied by Transpose_block.
+// When the destination's columns run right to left (xj is -1) the tile is
+// read bottom row first, which makes the rotation a plain transpose.
+// Pitches are the bytes from one row of an image to the next
+static void transpose_tile(const unsigned char *source,
+                           ptrdiff_t source_pitch, unsigned char *destination,
+                           ptrdiff_t destination_pitch,
+                           const struct transform *t, int ti, int tj,
+                           int i_end, int j_end, int pixel_bytes) {
+  assert(t->xi == 0 && t->yj == 0);
+  int first_row = t->xj > 0 ? tj : j_end - 1;
+  ptrdiff_t x = (ptrdiff_t)t->xj * first_row + t->x0;
+  ptrdiff_t y = (ptrdiff_t)t->yi * ti + t->y0;
+  Transpose_block(source + first_row * source_pitch
+                  + (ptrdiff_t)ti * pixel_bytes,
+                  t->xj * source_pitch,
+                  destination + y * destination_pitch + x * pixel_bytes,
+                  t->yi * destination_pitch, i_end - ti, j_end - tj,
+                  pixel_bytes);
+}
+
+// every suite in a family shares for_size, so this is true of the plain
+// suite and of its versions for particular element sizes
+static int is_plain(A2Methods_T methods) {
+  return methods->for_size == uarray2_methods_plain->for_size;
+}
+
+// the tiled kernel: the source is cut into tile x tile squares and each
+// square is copied whole.  A square of the source lands on a square of the
+// destination under every transform, so both stay in the cache while the
+// square is copied, whichever way the transform turns the rows.
+struct tiling {
+  A2Methods_T methods;
+  A2 source;
+  A2 destination;
+  struct transform t;
+  int tile;       // side of a tile in pixels
+  int tiles_wide; // number of tiles across the source
+};
+
+static void transform_tile(int number, void *cl) {
+  struct tiling *tl = cl;
+  A2Methods_T methods = tl->methods;
+  const struct transform *t = &tl->t;
+  int w = methods->width(tl->source);
+  int h = methods->height(tl->source);
+  int ti = number % tl->tiles_wide * tl->tile;
+  int tj = number / tl->tiles_wide * tl->tile;
+  int i_end = ti + tl->tile < w ? ti + tl->tile : w;
+  int j_end = tj + tl->tile < h ? tj + tl->tile : h;
+  if (is_plain(methods) && t->xi == 0) {
+    // a plain array is row-major pixels, so the tile needs no at
+    UArray2_view from = UArray2_view_of(tl->source);
+    UArray2_view to = UArray2_view_of(tl->destination);
+    transpose_tile((unsigned char *)from.base,
+                   (ptrdiff_t)from.columns * from.size,
+                   (unsigned char *)to.base,
+                   (ptrdiff_t)to.columns * to.size, t, ti, tj, i_end,
+                   j_end, from.size);
+    return;
+  }
+  for (int j = tj; j < j_end; j++) {
+    for (int i = ti; i < i_end; i++) {
+      Pnm_rgb from = methods->at(tl->source, i, j);
+      Pnm_rgb to = methods->at(tl->destination,
+                               t->xi * i + t->xj * j + t->x0,
+                               t->yi * i + t->yj * j + t->y0);
+      *to = *from;
+    }
+  }
+}
+
+// Tiles share no pixels in either image, so with more than one thread they
+// are handed out as tasks to a work pool.  With one thread they are done in
+// row-major order of tiles
+static void transform_tiled(A2Methods_T methods, A2 source, A2 destination,
+                            const struct transform *t, int tile, int nthreads)
+{
+  int w = methods->width(source);
+  int h = methods->height(source);
+  struct tiling tl = { methods, source, destination, *t, tile,
+                       (w + tile - 1) / tile };
+  int ntiles = tl.tiles_wide * ((h + tile - 1) / tile);
+  Workpool_run(ntiles, nthreads, transform_tile, &tl);
+}
+
+// The same tiled kernel for mapped raw PPMs, which hold pixels as 3 or 6
+// bytes in row-major order.  Along a row of a tile the destination moves a
+// fixed step, so no coordinates are worked out inside the loop.  Transforms
+// that swap the axes use transpose_tile instead
+struct raw_tiling {
+  const unsigned char *source;
+  unsigned char *destination;
+  int pixel_bytes;
+  int width, height; // of the source
+  struct transform t;
+  int tile;
+  int tiles_wide;
+};
+
+static void transform_raw_tile(int number, void *cl) {
+  struct raw_tiling *tl = cl;
+  const struct transform *t = &tl->t;
+  int ps = tl->pixel_bytes;
+  int ti = number % tl->tiles_wide * tl->tile;
+  int tj = number / tl->tiles_wide * tl->tile;
+  int i_end = ti + tl->tile < tl->width ? ti + tl->tile : tl->width;
+  int j_end = tj + tl->tile < tl->height ? tj + tl->tile : tl->height;
+  if (t->xi == 0) {
+    transpose_tile(tl->source, (ptrdiff_t)tl->width * ps, tl->destination,
+                   (ptrdiff_t)t->width * ps, t, ti, tj, i_end, j_end, ps);
+    return;
+  }
+  ptrdiff_t step = ((ptrdiff_t)t->yi * t->width + t->xi) * ps;
+  for (int j = tj; j < j_end; j++) {
+    const unsigned char *from = tl->source
+                                + ((size_t)j * tl->width + ti) * ps;
+    ptrdiff_t x = (ptrdiff_t)t->xi * ti + (ptrdiff_t)t->xj * j + t->x0;
+    ptrdiff_t y = (ptrdiff_t)t->yi * ti + (ptrdiff_t)t->yj * j + t->y0;
+    unsigned char *to = tl->destination + (y * t->width + x) * ps;
+    if (ps == 3) {
+      for (int i = ti; i < i_end; i++, from += 3, to += step)
+        memcpy(to, from, 3);
+    } else {
+      for (int i = ti; i < i_end; i++, from += 6, to += step)
+        memcpy(to, from, 6);
+    }
+  }
+}
+
+static void transform_raw(const struct Ppmmap *source, Ppmmap destination,
+                          const struct transform *t, int nthreads) {
+  int tile = tile_side(source->pixel_bytes);
+  struct raw_tiling tl = { source->pixels, destination->pixels,
+                           source->pixel_bytes, source->width,
+                           source->height, *t, tile,
+                           (source->width + tile - 1) / tile };
+  int ntiles = tl.tiles_wide * ((source->height + tile - 1) / tile);
+  Workpool_run(ntiles, nthreads, transform_raw_tile, &tl);
+}
+
+// In-place transforms move every pixel around the cycle of positions it
+// belongs to, carrying one pixel at a time, so no second image is needed.
+//
+// When the transform keeps the dimensions (180 degrees, the flips, and 90,
+// 270 or transpose of a square) no cycle is longer than 4, so the pixel that
+// comes first in row-major order is found by walking the cycle, and it
+// moves the cycle.  This goes through at and works in every suite.
+static void transform_in_place(A2Methods_T methods, A2 pixels,
+                               const struct transform *t) {
+  int w = methods->width(pixels);
+  int h = methods->height(pixels);
+  for (int j = 0; j < h; j++) {
+    for (int i = 0; i < w; i++) {
+      int x = i, y = j, leader = 1;
+      for (;;) {
+        int next_x = t->xi * x + t->xj * y + t->x0;
+        y = t->yi * x + t->yj * y + t->y0;
+        x = next_x;
+        if (x == i && y == j)
+          break;
+        if (y < j || (y == j && x < i)) {
+          leader = 0;
+          break;
+        }
+      }
+      if (!leader)
+        continue;
+      struct Pnm_rgb carry = *(Pnm_rgb)methods->at(pixels, i, j);
+      do {
+        int next_x = t->xi * x + t->xj * y + t->x0;
+        y = t->yi * x + t->yj * y + t->y0;
+        x = next_x;
+        Pnm_rgb to = methods->at(pixels, x, y);
+        struct Pnm_rgb moved = *to;
+        *to = carry;
+        carry = moved;
+      } while (x != i || y != j);
+    }
+  }
+}
+
+// the side of the tiles the in-place transpose moves whole.  It carries two
+// tiles while it writes a third, and all three stay in the L1 cache
+#define IN_PLACE_TILE 16
+
+// Transposes a w x h image of row-major pixels in place, leaving h x w.
+// Following the cycles of the transpose a pixel at a time visits the image
+// in random order, so instead, with b the side of a tile, the image is cut
+// into a core of whole b x b tiles, a strip of fewer than b columns down its
+// right and one of fewer than b rows along its bottom, and
+//  1. the strips are saved aside, and each band of b rows of the core is
+//     rearranged through a buffer so that its tiles are contiguous, one
+//     after another, and packed towards the start of the array;
+//  2. tile (I, J) of the core is tile (J, I) of the result, transposed, so
+//     the tiles are moved around the cycles of that permutation, each one
+//     transposed as it is carried, with a bit per tile marking the tiles
+//     already moved;
+//  3. from the last band of the result back to the first, so that no band
+//     is overwritten before it is read, the tiles are unpacked into rows of
+//     the result's width, and the saved strips are transposed into the
+//     gaps.
+// Every step works on a tile or a band of the image at a time.  Besides
+// the bitmap the buffers hold about b * (w + h) pixels
+static void transpose_in_place(unsigned char *base, int w, int h,
+                               int pixel_bytes) {
+  const size_t b = IN_PLACE_TILE, ps = pixel_bytes;
+  size_t H = h / b, W = w / b; // tiles down and across the core
+  size_t R = H * b, C = W * b; // rows and columns of the core
+  size_t hr = h - R, wr = w - C;
+  size_t pitch = w * ps, result_pitch = h * ps;
+  size_t tile_bytes = b * b * ps;
+  size_t band_bytes = b * (R > C ? R : C) * ps;
+  unsigned char *band = ALLOC(band_bytes + 2 * tile_bytes
+                              + (hr * w + R * wr) * ps);
+  unsigned char *carry = band + band_bytes;
+  unsigned char *spare = carry + tile_bytes;
+  unsigned char *bottom = spare + tile_bytes; // hr x w
+  unsigned char *right = bottom + hr * pitch; // R x wr
+  size_t ntiles = H * W;
+  unsigned char *moved = CALLOC(ntiles / 8 + 1, 1);
+
+  memcpy(bottom, base + R * pitch, hr * pitch);
+  for (size_t I = 0; I < H; I++) {
+    for (size_t r = 0; r < b; r++) {
+      const unsigned char *row = base + (I * b + r) * pitch;
+      for (size_t J = 0; J < W; J++)
+        memcpy(band + (J * b + r) * b * ps, row + J * b * ps, b * ps);
+      memcpy(right + (I * b + r) * wr * ps, row + C * ps, wr * ps);
+    }
+    memcpy(base + I * b * C * ps, band, b * C * ps);
+  }
+
+  for (size_t start = 0; start < ntiles; start++) {
+    if (moved[start / 8] & 1 << start % 8)
+      continue;
+    Transpose_block(base + start * tile_bytes, b * ps, carry, b * ps, b, b,
+                    ps);
+    size_t k = start;
+    for (;;) {
+      k = k % W * H + k / W;
+      moved[k / 8] |= 1 << k % 8;
+      unsigned char *tile = base + k * tile_bytes;
+      if (k == start) {
+        memcpy(tile, carry, tile_bytes);
+        break;
+      }
+      Transpose_block(tile, b * ps, spare, b * ps, b, b, ps);
+      memcpy(tile, carry, tile_bytes);
+      unsigned char *swap = carry;
+      carry = spare;
+      spare = swap;
+    }
+  }
+
+  for (size_t J = W; J-- > 0; ) {
+    memcpy(band, base + J * b * R * ps, b * R * ps);
+    for (size_t r = 0; r < b; r++) {
+      unsigned char *row = base + (J * b + r) * result_pitch;
+      for (size_t I = 0; I < H; I++)
+        memcpy(row + I * b * ps, band + (I * b + r) * b * ps, b * ps);
+    }
+  }
+  if (hr > 0)
+    Transpose_block(bottom, pitch, base + R * ps, result_pitch, w, hr, ps);
+  if (wr > 0)
+    Transpose_block(right, wr * ps, base + C * result_pitch, result_pitch,
+                    wr, R, ps);
+  FREE(moved);
+  FREE(band);
+}
+
+// reverses the order of the pixels in each row of a w x h image, or the
+// order of its rows, or both, by swapping pixels from either end
+static void flip_in_place(Pnm_rgb cells, size_t w, size_t h, int horizontal,
+                          int vertical) {
+  if (!horizontal && !vertical)
+    return;
+  for (size_t j = 0; j < (vertical ? (h + 1) / 2 : h); j++) {
+    Pnm_rgb row = cells + j * w;
+    Pnm_rgb other = cells + (vertical ? h - 1 - j : j) * w;
+    // a row swapped with itself stops half way, or it would swap back
+    size_t count = row == other ? w / 2 : w;
+    for (size_t i = 0; i < count; i++) {
+      Pnm_rgb a = row + i;
+      Pnm_rgb b = other + (horizontal ? w - 1 - i : i);
+      struct Pnm_rgb swap = *a;
+      *a = *b;
+      *b = swap;
+    }
+  }
+}
+
+// Every transform that swaps the axes is the transpose followed by a flip
+// of the rows, the columns or both, which is how it is done in place on a
+// plain array.  Pixel k of the row-major storage is then at position k of
+// the new shape
+static void transform_in_place_swapped(UArray2_T pixels,
+                                       const struct transform *t) {
+  assert(t->xi == 0 && t->yj == 0);
+  int w = UArray2_Columns(pixels);
+  int h = UArray2_Rows(pixels);
+  if (w > 0 && h > 0) {
+    Pnm_rgb cells = UArray2_row(pixels, 0, NULL);
+    transpose_in_place((unsigned char *)cells, w, h, sizeof *cells);
+    flip_in_place(cells, t->width, t->height, t->xj < 0, t->yi < 0);
+  }
+  UArray2_reshape(pixels, t->width, t->height);
+}
+
+// the kilobytes of this process's memory in transparent huge pages right
+// now, or -1 if the kernel does not say
+static long huge_page_kb(void) {
+  FILE *fp = fopen("/proc/self/smaps_rollup", "r");
+  if (fp == NULL)
+    return -1;
+  char line[128];
+  long kb = -1;
+  while (fgets(line, sizeof line, fp) != NULL)
+    if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+      break;
+  fclose(fp);
+  return kb;
+}
+
+// appends the time a w x h transform took, the peak resident set so far,
+// how much of the memory is in huge pages and the hardware counts per pixel
+// to the file
+static void report_time(const char *program, const char *time_file, int w,
+                        int h, Hwcount_T counters) {
+  FILE *timings = fopen(time_file, "a");
+  if (timings == NULL) {
+    fprintf(stderr, "%s: Could not open file %s for writing\n",
+            program, time_file);
+    exit(1);
+  }
+  double pixels = (double)w * h;
+  double elapsed = Hwcount_ns(counters);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(timings, "%dx%d: %.0f ns total, %.2f ns per pixel, "
+          "peak resident set %ld KB", w, h, elapsed,
+          pixels > 0 ? elapsed / pixels : 0.0, usage.ru_maxrss);
+  long huge = huge_page_kb();
+  if (huge >= 0)
+    fprintf(timings, ", %ld KB in huge pages", huge);
+  const char *separator = "; per pixel:";
+  for (int e = 0; e < HWCOUNT_EVENTS; e++) {
+    if (Hwcount_value(counters, e) >= 0 && pixels > 0) {
+      fprintf(timings, "%s %.3f %s", separator,
+              Hwcount_value(counters, e) / pixels, Hwcount_name(e));
+      separator = ",";
+    }
+  }
+  if (*separator == ';')
+    fprintf(timings, "; no hardware counters");
+  fprintf(timings, "\n");
+  fclose(timings);
+}
+
+// returns 1 if the two names are of the same existing file (perhaps by
+// different paths or links), and 0 otherwise
+static int same_file(const char *a, const char *b) {
+  struct stat sa, sb;
+  return stat(a, &sa) == 0 && stat(b, &sb) == 0
+         && sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+// transforms a raw PPM straight from its mapped file into a mapped output
+// file, or into memory that is then written to stdout.  There is no pixel
+// array and no parsing beyond the header.  An output file that is the
+// input itself cannot be truncated while the input is mapped, so then the
+// image is made in memory and written over the input once it is unmapped.
+// Frees the input
+static void transform_mapped(const char *program, const char *input_file,
+                             Ppmmap *input, const char *output_file,
+                             struct transform t, int nthreads,
+                             const char *time_file) {
+  int overwrite = output_file != NULL && same_file(input_file, output_file);
+  Ppmmap output = Ppmmap_create(overwrite ? NULL : output_file, t.width,
+                                t.height, (*input)->denominator);
+  if (output == NULL) {
+    fprintf(stderr, "%s: Could not create file %s\n", program,
+            output_file);
+    exit(1);
+  }
+  Hwcount_T counters = Hwcount_new();
+  Hwcount_start(counters);
+  transform_raw(*input, output, &t, nthreads);
+  Hwcount_stop(counters);
+  if (time_file != NULL)
+    report_time(program, time_file, (*input)->width, (*input)->height,
+                counters);
+  Hwcount_free(&counters);
+  Ppmmap_free(input);
+  if (output_file == NULL || overwrite) {
+    FILE *out = output_file == NULL ? stdout : fopen(output_file, "wb");
+    if (out == NULL || !Ppmmap_write(out, output)
+        || (out != stdout && fclose(out) != 0)) {
+      fprintf(stderr, "%s: Could not write the image\n", program);
+      exit(1);
+    }
+  }
+  Ppmmap_free(&output);
+}
 
 int main(int argc, char *argv[]) {
-  int rotation = 0;
+  // every -rotate, -flip and -transpose, in the order given
+  struct symmetry symmetry = identity;
+  int tiled = 0;
+  int in_place = 0;
+  int chose_methods = 0; // mapped raw input is only used if this stays 0
+  int nthreads = 1; // 0 means one per online processor
+  char *time_file = NULL;
+  char *output_file = NULL;
   A2Methods_T methods = uarray2_methods_plain; // default to UArray2 methods
   assert(methods);
   A2Methods_mapfun *map = methods->map_default; // default to best map
@@ -18,6 +560,7 @@ int main(int argc, char *argv[]) {
       methods = (METHODS); \
       assert(methods); \
       map = methods->MAP; \
+      chose_methods = 1; \
       if (!map) { \
         fprintf(stderr, "%s does not support " WHAT "mapping\n", argv[0]); \
         exit(1); \
@@ -32,23 +575,212 @@ int main(int argc, char *argv[]) {
       SET_METHODS(uarray2_methods_plain, map_col_major, "column-major");
     } else if (!strcmp(argv[i], "-block-major")) {
       SET_METHODS(uarray2_methods_blocked, map_block_major, "block-major");
+    } else if (!strcmp(argv[i], "-zorder-major")) {
+      SET_METHODS(uarray2_methods_zorder, map_default, "z-order");
     } else if (!strcmp(argv[i], "-rotate")) {
       assert(i + 1 < argc);
       char *endptr;
-      rotation = strtol(argv[++i], &endptr, 10);
+      int rotation = strtol(argv[++i], &endptr, 10);
       assert(*endptr == '\0'); // parsed all correctly
       assert(rotation == 0   || rotation == 90
           || rotation == 180 || rotation == 270);
+      symmetry = compose(symmetry, rotation_symmetry(rotation));
+    } else if (!strcmp(argv[i], "-flip")) {
+      assert(i + 1 < argc);
+      i++;
+      if (!strcmp(argv[i], "horizontal")) {
+        symmetry = compose(symmetry, flip_symmetry(1));
+      } else if (!strcmp(argv[i], "vertical")) {
+        symmetry = compose(symmetry, flip_symmetry(0));
+      } else {
+        fprintf(stderr, "%s: -flip takes horizontal or vertical\n", argv[0]);
+        exit(1);
+      }
+    } else if (!strcmp(argv[i], "-transpose")) {
+      symmetry = compose(symmetry, transpose_symmetry);
+    } else if (!strcmp(argv[i], "-tiled")) {
+      tiled = 1;
+    } else if (!strcmp(argv[i], "-in-place")) {
+      in_place = 1;
+    } else if (!strcmp(argv[i], "-threads")) {
+      assert(i + 1 < argc);
+      char *endptr;
+      nthreads = strtol(argv[++i], &endptr, 10);
+      assert(*endptr == '\0' && nthreads >= 0);
+    } else if (!strcmp(argv[i], "-time")) {
+      assert(i + 1 < argc);
+      time_file = argv[++i];
+    } else if (!strcmp(argv[i], "-pages")) {
+      assert(i + 1 < argc);
+      Bigmem_pages pages;
+      if (!Bigmem_pages_named(argv[++i], &pages)) {
+        fprintf(stderr, "%s: -pages takes small, huge or hugetlb\n",
+                argv[0]);
+        exit(1);
+      }
+      Bigmem_set_pages(pages);
+    } else if (!strcmp(argv[i], "-kernel")) {
+      assert(i + 1 < argc);
+      Transpose_kernel kernel;
+      if (!Transpose_kernel_named(argv[++i], &kernel)) {
+        fprintf(stderr, "%s: -kernel takes scalar, sse2 or avx2\n",
+                argv[0]);
+        exit(1);
+      }
+      if (!Transpose_set_kernel(kernel)) {
+        fprintf(stderr, "%s: this CPU cannot run the %s kernel\n",
+                argv[0], argv[i]);
+        exit(1);
+      }
+    } else if (!strcmp(argv[i], "-o")) {
+      assert(i + 1 < argc);
+      output_file = argv[++i];
     } else if (*argv[i] == '-') {
       fprintf(stderr, "%s: unknown option '%s'\n", argv[0], argv[i]);
       exit(1);
     } else if (argc - i > 2) {
-      fprintf(stderr, "Usage: %s [-rotate <angle>] "
-              "[-{row,col,block}-major] [filename]\n", argv[0]);
+      fprintf(stderr, "Usage: %s [-rotate <angle> | -flip <direction> | "
+              "-transpose]... [-{row,col,block,zorder}-major] "
+              "[-tiled | -in-place] [-threads <n>] "
+              "[-pages small|huge|hugetlb] [-kernel scalar|sse2|avx2] "
+              "[-time <file>] [-o <file>] [filename]\n", argv[0]);
       exit(1);
     } else {
       break;
     }
   }
-   assert(0); // the rest of this function is not yet implemented
+
+  // switch to the suite's version for pixels, keeping the chosen mapping
+  A2Methods_T sized = methods->for_size(sizeof(struct Pnm_rgb));
+  if (map == methods->map_row_major)
+    map = sized->map_row_major;
+  else if (map == methods->map_col_major)
+    map = sized->map_col_major;
+  else if (map == methods->map_block_major)
+    map = sized->map_block_major;
+  else
+    map = sized->map_default;
+  methods = sized;
+
+  // more than one thread needs the parallel version of the chosen mapping;
+  // one thread uses the span version if there is one
+  A2Methods_parallel_mapfun *parallel_map = NULL;
+  A2Methods_spanmapfun *span_map = NULL;
+  if (map == methods->map_row_major) {
+    parallel_map = methods->map_row_major_parallel;
+    span_map = methods->map_spans_row_major;
+  } else if (map == methods->map_block_major) {
+    parallel_map = methods->map_block_major_parallel;
+    span_map = methods->map_spans_block_major;
+  }
+  if (nthreads != 1 && !tiled && parallel_map == NULL) {
+    fprintf(stderr, "%s does not support this mapping with threads\n",
+            argv[0]);
+    exit(1);
+  }
+
+  // the transpose kernel is chosen now, before worker threads share it
+  Transpose_get_kernel();
+
+  if (in_place && (tiled || nthreads != 1)) {
+    fprintf(stderr, "%s: -in-place works with one thread and without "
+            "-tiled\n", argv[0]);
+    exit(1);
+  }
+
+  // a raw PPM in a regular file needs no reading at all; anything else
+  // (a pipe, a plain PPM) goes through Pnm_ppmread and the chosen suite
+  if (i < argc && !chose_methods && !in_place) {
+    Ppmmap input = Ppmmap_read(argv[i]);
+    if (input != NULL) {
+      struct transform t = placed(symmetry, input->width, input->height);
+      transform_mapped(argv[0], argv[i], &input, output_file, t, nthreads,
+                       time_file);
+      return 0;
+    }
+  }
+
+  FILE *fp = stdin;
+  if (i < argc) {
+    fp = fopen(argv[i], "rb");
+    if (fp == NULL) {
+      fprintf(stderr, "%s: Could not open file %s for reading\n",
+              argv[0], argv[i]);
+      exit(1);
+    }
+  }
+  Pnm_ppm image = Pnm_ppmread(fp, methods);
+  if (fp != stdin)
+    fclose(fp);
+
+  // the output is opened only now, so that it may be the input file
+  FILE *out = stdout;
+  if (output_file != NULL) {
+    out = fopen(output_file, "wb");
+    if (out == NULL) {
+      fprintf(stderr, "%s: Could not open file %s for writing\n",
+              argv[0], output_file);
+      exit(1);
+    }
+  }
+
+  int w = image->width;
+  int h = image->height;
+  struct transform t = placed(symmetry, w, h);
+
+  // the identity transform writes the image back out without copying it
+  struct Pnm_ppm result = *image;
+  Hwcount_T counters = Hwcount_new();
+  if (in_place && !is_identity(&t)) {
+    if ((t.width != w || t.height != h)
+        && !is_plain(methods)) {
+      fprintf(stderr, "%s: -in-place needs the row-major suite to change "
+              "the shape of an image\n", argv[0]);
+      exit(1);
+    }
+    result.width = t.width;
+    result.height = t.height;
+    Hwcount_start(counters);
+    if (t.xi == 0 && is_plain(methods))
+      transform_in_place_swapped(image->pixels, &t);
+    else
+      transform_in_place(methods, image->pixels, &t);
+    Hwcount_stop(counters);
+  } else if (!is_identity(&t)) {
+    result.width = t.width;
+    result.height = t.height;
+    int blocksize = methods->blocksize(image->pixels);
+    result.pixels = methods->new_with_blocksize(t.width, t.height,
+                                                sizeof(struct Pnm_rgb),
+                                                blocksize);
+    Hwcount_start(counters);
+    if (tiled) {
+      // blocked arrays are tiled by their own blocks
+      int tile = blocksize > 1 ? blocksize
+                               : tile_side(sizeof(struct Pnm_rgb));
+      transform_tiled(methods, image->pixels, result.pixels, &t, tile,
+                      nthreads);
+    } else {
+      struct copy_closure cl = { methods, result.pixels, t };
+      if (nthreads == 1 && span_map != NULL)
+        span_map(image->pixels, copy_span, &cl);
+      else if (nthreads == 1)
+        map(image->pixels, copy_pixel, &cl);
+      else
+        parallel_map(image->pixels, copy_pixel, &cl, nthreads);
+    }
+    Hwcount_stop(counters);
+  }
+
+  if (time_file != NULL)
+    report_time(argv[0], time_file, w, h, counters);
+  Hwcount_free(&counters);
+
+  Pnm_ppmwrite(out, &result);
+  if (out != stdout)
+    fclose(out);
+  if (result.pixels != image->pixels)
+    methods->free(&result.pixels);
+  Pnm_ppmfree(&image);
+  return 0;
 }
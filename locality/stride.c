@@ -1,8 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
 #include <time.h>
+#include <pthread.h>
+#include <unistd.h>
 
+#include "hwcount.h"
+#include "cachesize.h"
+
+// Two ways to run:
+//
+//   stride megabytes stride
+//       the lab's single measurement: XOR every byte of a buffer, visiting
+//       it stride bytes apart
+//
+//   stride -sweep [-mode stride|latency|bandwidth|all] [-max megabytes]
+//                 [-threads n] [-trials n] [-json] [-v]
+//       sweeps working-set sizes (two per octave, from 4KiB) and prints one
+//       row per measurement as CSV, or as JSON, with the level of the
+//       memory hierarchy each size was judged to fit in.  With -v each
+//       measurement is also reported on stderr as it finishes.  The modes
+//       are
+//         stride    - the lab's XOR loop at strides 1, 4, 16, ... 4096
+//         latency   - a dependent chase of pointers in random order, one
+//                     per cache line, so no load can start before the
+//                     last one finishes
+//         bandwidth - threads reading their own part of the working set
+//                     from start to end, as fast as they can
+//
+// The levels are found from the latency curve alone: the chase shows them
+// sharply, while streaming and strided loops are overlapped by prefetching
+// and, with several threads, share the caches unevenly, so their curves rise
+// at sizes that are no boundary.  If the latency curve is not asked for, a
+// quick one of LEVEL_TRIALS trials per size is run for the levels and not
+// printed.
+//
+// Every measurement is warmed up once and then timed in several trials of
+// at least MIN_TRIAL_NS each with clock_gettime; the best and the median
+// trial are reported.  Where the hardware counters in hwcount.h can be
+// read, each measurement also reports cycles, instructions and L1, LLC and
+// TLB misses per load, averaged over the trials.
+
+#define LINE 64                  // bytes in a cache line
+#define MIN_SWEEP_BYTES 4096
+#define MIN_TRIAL_NS 20e6        // each trial runs at least this long
+#define DEFAULT_TRIALS 5
+#define LEVEL_TRIALS 2           // for a latency curve run only for levels
+#define DEFAULT_MAX_BYTES (64L * 1024 * 1024) // when sysfs knows no caches
+#define MAX_SIZES 128
+#define MAX_LEVELS 8
+
+// a level boundary is where the cost of a load rises by at least JUMP over
+// the level below; the next level starts once the cost stops rising by
+// SETTLE from one size to the next
+#define JUMP 1.5
+#define SETTLE 1.15
+// a latency this many times that of L1 can only be DRAM
+#define DRAM_FACTOR 30
+
+volatile int sink; // keeps results from being optimized away
+static Hwcount_T counters; // for every measurement
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// A kernel runs its loads reps times over and returns how many loads it did
+typedef double kernel(void *cl, long reps);
+
+struct measurement {
+  double best;   // ns per load in the fastest trial
+  double median; // ns per load in the median trial
+  double per_load[HWCOUNT_EVENTS]; // counts per load, or -1 if unavailable
+};
+
+static struct measurement measure(kernel *k, void *cl, int trials) {
+  k(cl, 1); // warm up the caches and TLB, and fault in the pages
+  long reps = 1;
+  for (;;) {
+    double start = now();
+    k(cl, reps);
+    if (now() - start >= MIN_TRIAL_NS)
+      break;
+    reps *= 2;
+  }
+  double *times = malloc(trials * sizeof *times);
+  assert(times);
+  double total_loads = 0;
+  Hwcount_start(counters);
+  for (int t = 0; t < trials; t++) {
+    double start = now();
+    double loads = k(cl, reps);
+    times[t] = (now() - start) / loads;
+    total_loads += loads;
+  }
+  Hwcount_stop(counters);
+  qsort(times, trials, sizeof *times, compare_doubles);
+  struct measurement m = { times[0], times[trials / 2], { 0 } };
+  for (int e = 0; e < HWCOUNT_EVENTS; e++) {
+    double count = Hwcount_value(counters, e);
+    m.per_load[e] = count >= 0 ? count / total_loads : -1;
+  }
+  free(times);
+  return m;
+}
+
+// the lab's kernel: every byte is loaded once, stride bytes apart
 static char xor(const char *p, const char *limit, int stride) {
   assert(stride > 0);
   char sum = 0;
@@ -12,13 +125,372 @@ static char xor(const char *p, const char *limit, int stride) {
   return sum;
 }
 
-volatile int sink; // keeps result from being optimized away
+struct stride_closure {
+  char *p;
+  size_t bytes;
+  int stride;
+};
 
-int main(int argc, char *argv[]) {
-  if (argc != 3) {
-    fprintf(stderr, "Usage: %s megabytes stride\n", argv[0]);
-    exit(1);
+static double stride_kernel(void *vcl, long reps) {
+  struct stride_closure *cl = vcl;
+  for (long r = 0; r < reps; r++)
+    sink = xor(cl->p, cl->p + cl->bytes, cl->stride);
+  return (double)cl->bytes * reps;
+}
+
+// the chase: the first word of every line of the buffer points to the next
+// line to visit, in a random order that visits every line once
+struct chase_closure {
+  void **start;
+  size_t lines;
+};
+
+static uint64_t random_state = 88172645463325252ULL;
+static uint64_t xorshift(void) {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return random_state;
+}
+
+// links the lines into one cycle in random order (Sattolo's algorithm)
+static void **link_lines(char *p, size_t lines) {
+  size_t *order = malloc(lines * sizeof *order);
+  assert(order);
+  for (size_t k = 0; k < lines; k++)
+    order[k] = k;
+  for (size_t k = lines - 1; k > 0; k--) {
+    size_t other = xorshift() % k;
+    size_t swap = order[k];
+    order[k] = order[other];
+    order[other] = swap;
+  }
+  for (size_t k = 0; k < lines; k++)
+    *(void **)(p + order[k] * LINE) = p + order[(k + 1) % lines] * LINE;
+  void **start = (void **)(p + order[0] * LINE);
+  free(order);
+  return start;
+}
+
+static double chase_kernel(void *vcl, long reps) {
+  struct chase_closure *cl = vcl;
+  void **q = cl->start;
+  for (long r = 0; r < reps; r++)
+    for (size_t k = 0; k < cl->lines; k++)
+      q = *q;
+  sink = q != NULL;
+  return (double)cl->lines * reps;
+}
+
+// streaming: each thread sums its own words of the buffer reps times
+struct stream_part {
+  const uint64_t *words;
+  size_t count;
+  long reps;
+};
+
+static void *stream_part(void *vpart) {
+  struct stream_part *part = vpart;
+  uint64_t a = 0, b = 0, c = 0, d = 0;
+  for (long r = 0; r < part->reps; r++) {
+    size_t k = 0;
+    for (; k + 4 <= part->count; k += 4) {
+      a += part->words[k];
+      b += part->words[k + 1];
+      c += part->words[k + 2];
+      d += part->words[k + 3];
+    }
+    for (; k < part->count; k++)
+      a += part->words[k];
+  }
+  sink = (int)(a + b + c + d);
+  return NULL;
+}
+
+struct stream_closure {
+  uint64_t *words;
+  size_t count;
+  int nthreads;
+};
+
+static double stream_kernel(void *vcl, long reps) {
+  struct stream_closure *cl = vcl;
+  struct stream_part parts[cl->nthreads];
+  pthread_t threads[cl->nthreads];
+  for (int t = 0; t < cl->nthreads; t++) {
+    size_t first = cl->count * t / cl->nthreads;
+    size_t last = cl->count * (t + 1) / cl->nthreads;
+    parts[t] = (struct stream_part){ cl->words + first, last - first, reps };
+  }
+  // thread 0 is the caller; a thread that cannot start is done by it too
+  for (int t = 1; t < cl->nthreads; t++)
+    if (pthread_create(&threads[t], NULL, stream_part, &parts[t]))
+      threads[t] = pthread_self();
+  stream_part(&parts[0]);
+  for (int t = 1; t < cl->nthreads; t++) {
+    if (pthread_equal(threads[t], pthread_self()))
+      stream_part(&parts[t]);
+    else
+      pthread_join(threads[t], NULL);
+  }
+  return (double)cl->count * reps;
+}
+
+// the result of one mode of the sweep, one entry per size and stride
+struct row {
+  const char *mode;
+  size_t bytes;
+  int stride; // bytes between loads; 0 when it does not apply
+  int threads;
+  struct measurement m;
+};
+
+// the levels of the memory hierarchy found by a sweep
+struct hierarchy {
+  int levels;
+  size_t top[MAX_LEVELS]; // the largest size measured in each level
+  char names[MAX_LEVELS][12];
+};
+
+// Finds the levels of the hierarchy from the best cost of a load at each
+// size of the latency curve (rows in increasing size).  A size where the
+// cost is still rising into the next level counts as being in that level.
+// The last level is DRAM if the sweep went past the largest cache sysfs
+// knows of, or if its latency is DRAM_FACTOR times that of L1.  The last
+// cache level is called LLC once there are more than two
+static struct hierarchy find_levels(const struct row *rows, int n,
+                                    long cache_bytes) {
+  struct hierarchy h = { 1, { 0 }, { "" } };
+  double base = rows[0].m.best;
+  for (int k = 0; k < n; k++) {
+    if (k > 0 && rows[k].m.best >= JUMP * base && h.levels < MAX_LEVELS) {
+      h.levels++;
+      while (k + 1 < n && rows[k + 1].m.best >= SETTLE * rows[k].m.best)
+        k++;
+      base = rows[k].m.best;
+    }
+    h.top[h.levels - 1] = rows[k].bytes;
+  }
+  int dram = h.levels > 1
+    && ((cache_bytes > 0 && h.top[h.levels - 1] > (size_t)cache_bytes
+         && h.top[h.levels - 2] <= (size_t)cache_bytes)
+        || base >= DRAM_FACTOR * rows[0].m.best);
+  for (int l = 0; l < h.levels; l++)
+    snprintf(h.names[l], sizeof h.names[l], "L%d", l + 1);
+  if (dram)
+    strcpy(h.names[h.levels - 1], "DRAM");
+  if (h.levels - dram > 2)
+    strcpy(h.names[h.levels - dram - 1], "LLC");
+  return h;
+}
+
+static const char *level_of(const struct hierarchy *h, size_t bytes) {
+  for (int l = 0; l < h->levels - 1; l++)
+    if (bytes <= h->top[l])
+      return h->names[l];
+  return h->names[h->levels - 1];
+}
+
+struct options {
+  int stride, latency, bandwidth;
+  size_t max_bytes;
+  int nthreads;
+  int trials;
+  int json;
+  int verbose;
+};
+
+static int sweep_sizes(size_t max_bytes, size_t *sizes) {
+  int n = 0;
+  for (size_t octave = MIN_SWEEP_BYTES; octave <= max_bytes && n < MAX_SIZES;
+       octave *= 2) {
+    sizes[n++] = octave;
+    // about 1.41 times the octave, in whole lines
+    size_t middle = (size_t)(octave * 1.41421356) / LINE * LINE;
+    if (middle <= max_bytes && n < MAX_SIZES)
+      sizes[n++] = middle;
   }
+  return n;
+}
+
+static void print_rows(const struct row *rows, int n,
+                       const struct hierarchy *h, int json, int *first) {
+  for (int k = 0; k < n; k++) {
+    const struct row *r = &rows[k];
+    double gbps = 8.0 / r->m.best; // bandwidth mode loads 8-byte words
+    if (json) {
+      printf("%s\n    {\"mode\": \"%s\", \"bytes\": %zu, \"stride\": %d, "
+             "\"threads\": %d, \"ns_per_load_best\": %.3f, "
+             "\"ns_per_load_median\": %.3f, ", *first ? "" : ",", r->mode,
+             r->bytes, r->stride, r->threads, r->m.best, r->m.median);
+      if (!strcmp(r->mode, "bandwidth"))
+        printf("\"gb_per_s\": %.2f, ", gbps);
+      for (int e = 0; e < HWCOUNT_EVENTS; e++)
+        if (r->m.per_load[e] >= 0)
+          printf("\"%s_per_load\": %.4f, ", Hwcount_name(e),
+                 r->m.per_load[e]);
+      printf("\"level\": \"%s\"}", level_of(h, r->bytes));
+    } else {
+      printf("%s,%zu,%d,%d,%.3f,%.3f,", r->mode, r->bytes, r->stride,
+             r->threads, r->m.best, r->m.median);
+      if (!strcmp(r->mode, "bandwidth"))
+        printf("%.2f", gbps);
+      printf(",%s", level_of(h, r->bytes));
+      // counter columns are left empty where there are no counters
+      for (int e = 0; e < HWCOUNT_EVENTS; e++)
+        if (r->m.per_load[e] >= 0)
+          printf(",%.4f", r->m.per_load[e]);
+        else
+          printf(",");
+      printf("\n");
+    }
+    *first = 0;
+  }
+}
+
+// Measures one curve of the sweep, the given mode at every size, in trials
+// trials each, into rows.  The buffer is as large as the largest size
+static void measure_curve(const char *mode, int stride, char *buffer,
+                          size_t *sizes, int nsizes, struct options *o,
+                          int trials, struct row *rows) {
+  for (int s = 0; s < nsizes; s++) {
+    struct row *r = &rows[s];
+    *r = (struct row){ mode, sizes[s], stride, 1, { 0, 0, { 0 } } };
+    if (!strcmp(mode, "stride")) {
+      struct stride_closure cl = { buffer, sizes[s], stride };
+      r->m = measure(stride_kernel, &cl, trials);
+    } else if (!strcmp(mode, "latency")) {
+      struct chase_closure cl = { link_lines(buffer, sizes[s] / LINE),
+                                  sizes[s] / LINE };
+      r->m = measure(chase_kernel, &cl, trials);
+    } else {
+      struct stream_closure cl = { (uint64_t *)buffer,
+                                   sizes[s] / sizeof(uint64_t),
+                                   o->nthreads };
+      r->threads = o->nthreads;
+      r->m = measure(stream_kernel, &cl, trials);
+    }
+    if (o->verbose)
+      fprintf(stderr, "%s %zu bytes stride %d: %.2f ns\n", mode, sizes[s],
+              stride, r->m.best);
+  }
+}
+
+// Measures one curve and prints it, labelled with the levels in *h
+static void sweep_curve(const char *mode, int stride, char *buffer,
+                        size_t *sizes, int nsizes, struct options *o,
+                        const struct hierarchy *h, int *first) {
+  struct row rows[MAX_SIZES];
+  measure_curve(mode, stride, buffer, sizes, nsizes, o, o->trials, rows);
+  print_rows(rows, nsizes, h, o->json, first);
+}
+
+static void sweep(struct options *o) {
+  long cache_bytes = Cachesize_largest();
+  size_t sizes[MAX_SIZES];
+  int nsizes = sweep_sizes(o->max_bytes, sizes);
+  assert(nsizes > 0);
+  char *buffer = malloc(sizes[nsizes - 1]);
+  if (buffer == NULL) {
+    fprintf(stderr, "stride: Cannot allocate %zu bytes\n",
+            sizes[nsizes - 1]);
+    exit(2);
+  }
+  memset(buffer, 1, sizes[nsizes - 1]);
+
+  // the levels come from the latency curve, measured first; it is measured
+  // quickly if it is only for the levels
+  struct row latency[MAX_SIZES];
+  measure_curve("latency", LINE, buffer, sizes, nsizes, o,
+                o->latency ? o->trials : LEVEL_TRIALS, latency);
+  struct hierarchy h = find_levels(latency, nsizes, cache_bytes);
+  int first = 1;
+  if (o->json)
+    printf("{\n  \"largest_cache_bytes\": %ld,\n  \"results\": [",
+           cache_bytes);
+  else {
+    printf("mode,bytes,stride,threads,ns_per_load_best,"
+           "ns_per_load_median,gb_per_s,level");
+    for (int e = 0; e < HWCOUNT_EVENTS; e++)
+      printf(",%s_per_load", Hwcount_name(e));
+    printf("\n");
+  }
+  if (o->latency)
+    print_rows(latency, nsizes, &h, o->json, &first);
+  if (o->bandwidth)
+    sweep_curve("bandwidth", 0, buffer, sizes, nsizes, o, &h, &first);
+  if (o->stride)
+    for (int stride = 1; stride <= 4096; stride *= 4)
+      sweep_curve("stride", stride, buffer, sizes, nsizes, o, &h, &first);
+  if (o->json) {
+    printf("\n  ],\n  \"boundaries\": [");
+    for (int l = 0; l < h.levels; l++)
+      printf("%s\n    {\"level\": \"%s\", \"largest_bytes\": %zu}",
+             l > 0 ? "," : "", h.names[l], h.top[l]);
+    printf("\n  ]\n}\n");
+  }
+  free(buffer);
+}
+
+static void usage(const char *program) {
+  fprintf(stderr, "Usage: %s megabytes stride\n"
+          "       %s -sweep [-mode stride|latency|bandwidth|all] "
+          "[-max megabytes]\n"
+          "              [-threads n] [-trials n] [-json] [-v]\n",
+          program, program);
+  exit(1);
+}
+
+static int sweep_main(int argc, char *argv[]) {
+  long cache_bytes = Cachesize_largest();
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  struct options o = { 1, 1, 1,
+                       cache_bytes > DEFAULT_MAX_BYTES / 2
+                         ? 2 * (size_t)cache_bytes : DEFAULT_MAX_BYTES,
+                       online > 0 ? (int)online : 1,
+                       DEFAULT_TRIALS, 0, 0 };
+  for (int i = 2; i < argc; i++) {
+    if (!strcmp(argv[i], "-mode") && i + 1 < argc) {
+      const char *mode = argv[++i];
+      int all = !strcmp(mode, "all");
+      o.stride = all || !strcmp(mode, "stride");
+      o.latency = all || !strcmp(mode, "latency");
+      o.bandwidth = all || !strcmp(mode, "bandwidth");
+      if (!o.stride && !o.latency && !o.bandwidth)
+        usage(argv[0]);
+    } else if (!strcmp(argv[i], "-max") && i + 1 < argc) {
+      double megabytes = atof(argv[++i]);
+      if (megabytes <= 0)
+        usage(argv[0]);
+      o.max_bytes = megabytes * 1024 * 1024;
+      if (o.max_bytes < MIN_SWEEP_BYTES)
+        usage(argv[0]);
+    } else if (!strcmp(argv[i], "-threads") && i + 1 < argc) {
+      o.nthreads = atoi(argv[++i]);
+      if (o.nthreads <= 0)
+        usage(argv[0]);
+    } else if (!strcmp(argv[i], "-trials") && i + 1 < argc) {
+      o.trials = atoi(argv[++i]);
+      if (o.trials <= 0)
+        usage(argv[0]);
+    } else if (!strcmp(argv[i], "-json")) {
+      o.json = 1;
+    } else if (!strcmp(argv[i], "-v")) {
+      o.verbose = 1;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  sweep(&o);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  counters = Hwcount_new();
+  if (argc >= 2 && !strcmp(argv[1], "-sweep"))
+    return sweep_main(argc, argv);
+  if (argc != 3)
+    usage(argv[0]);
   double megabytes = atof(argv[1]);
   int stride = atoi(argv[2]);
   assert(megabytes > 0 && stride > 0);
@@ -28,28 +500,30 @@ int main(int argc, char *argv[]) {
 
   if (!p) {
     if ((double)(size_t) megabytes == megabytes)
-      fprintf(stderr, "%s: Cannot allocate %.2fMiB\n", argv[0], megabytes);
-    else
       fprintf(stderr, "%s: Cannot allocate %dMiB\n", argv[0], (int)megabytes);
+    else
+      fprintf(stderr, "%s: Cannot allocate %.2fMiB\n", argv[0], megabytes);
     exit(2);
   }
+  memset(p, 1, bytes);
 
-  clock_t start = clock();
-  int iter = 500 / megabytes;
-  if (iter < 5)
-    iter = 5;
-  for (int i = 0; i < iter; i++) 
-    sink = xor(p, p+bytes, stride);
-  clock_t stop = clock();
-  double loads = (double) bytes * iter;
-  double seconds = (double)(stop - start)/(double)CLOCKS_PER_SEC;
+  struct stride_closure cl = { p, bytes, stride };
+  struct measurement m = measure(stride_kernel, &cl, DEFAULT_TRIALS);
   if ((double)(size_t) megabytes == megabytes)
     printf("%dMiB", (int) megabytes);
   else
     printf("%.2fMiB", megabytes);
-  printf(" stride %d results in %5.2fns CPU time per load"
-         " (total %.3fs)\n",
-         stride, seconds/1e-9/loads, seconds);
+  printf(" stride %d results in %5.2fns per load"
+         " (best of %d trials, median %.2fns)\n",
+         stride, m.best, DEFAULT_TRIALS, m.median);
+  const char *separator = "per load:";
+  for (int e = 0; e < HWCOUNT_EVENTS; e++) {
+    if (m.per_load[e] >= 0) {
+      printf("%s %.4f %s", separator, m.per_load[e], Hwcount_name(e));
+      separator = ",";
+    }
+  }
+  printf("%s\n", *separator == 'p' ? "no hardware counters" : "");
+  free(p);
   return 0;
 }
-  
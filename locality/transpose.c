@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "assert.h"
+#include "transpose.h"
+
+// the vector kernels are compiled for their instruction sets function by
+// function, so the rest of the program needs no special flags and still
+// runs on a CPU without them
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPOSE_X86
+#include <immintrin.h>
+#define SSE2_TARGET __attribute__((target("sse2")))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+typedef unsigned char byte;
+
+typedef void kernelfun(const byte *from, ptrdiff_t from_stride, byte *to,
+                       ptrdiff_t to_stride, int columns, int rows, int size);
+
+static const char *names[TRANSPOSE_KERNELS] = { "scalar", "sse2", "avx2" };
+
+// -1 until the kernel is set or chosen
+static int chosen = -1;
+
+// copies one pixel at a time.  The size is a constant for the common sizes,
+// so each copy is a move or two instead of a call to memcpy
+#define SCALAR_COPY(SIZE) \
+  for (int j = 0; j < rows; j++) { \
+    const byte *in = from + j * from_stride; \
+    byte *out = to + (ptrdiff_t)j * (SIZE); \
+    for (int i = 0; i < columns; i++, in += (SIZE), out += to_stride) \
+      memcpy(out, in, (SIZE)); \
+  }
+
+static void transpose_scalar(const byte *from, ptrdiff_t from_stride,
+                             byte *to, ptrdiff_t to_stride, int columns,
+                             int rows, int size) {
+  switch (size) {
+  case 3:  SCALAR_COPY(3) break;
+  case 4:  SCALAR_COPY(4) break;
+  case 6:  SCALAR_COPY(6) break;
+  case 12: SCALAR_COPY(12) break;
+  default: SCALAR_COPY(size) break;
+  }
+}
+
+#ifdef TRANSPOSE_X86
+// hands the pixels that do not fill a side x side square to another
+// kernel: a strip down the right of the source and one along its bottom
+static void transpose_edges(const byte *from, ptrdiff_t from_stride,
+                            byte *to, ptrdiff_t to_stride, int columns,
+                            int rows, int size, int side, kernelfun *kernel)
+{
+  int full_columns = columns - columns % side;
+  int full_rows = rows - rows % side;
+  if (full_columns < columns)
+    kernel(from + (ptrdiff_t)full_columns * size, from_stride,
+           to + full_columns * to_stride, to_stride, columns - full_columns,
+           full_rows, size);
+  if (full_rows < rows)
+    kernel(from + full_rows * from_stride, from_stride,
+           to + (ptrdiff_t)full_rows * size, to_stride, columns,
+           rows - full_rows, size);
+}
+
+// calls SQUARE on every whole side x side square of the block
+#define SQUARES(SQUARE, SIDE) \
+  for (int j = 0; j + (SIDE) <= rows; j += (SIDE)) \
+    for (int i = 0; i + (SIDE) <= columns; i += (SIDE)) \
+      SQUARE(from + j * from_stride + (ptrdiff_t)i * size, from_stride, \
+             to + i * to_stride + (ptrdiff_t)j * size, to_stride)
+
+// the 4x4 transpose of 32-bit lanes: lane k of r[c] becomes lane c of r[k]
+SSE2_TARGET static inline void transpose4_epi32(__m128i r[4]) {
+  __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]); // a0 b0 a1 b1
+  __m128i t1 = _mm_unpacklo_epi32(r[2], r[3]); // c0 d0 c1 d1
+  __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]); // a2 b2 a3 b3
+  __m128i t3 = _mm_unpackhi_epi32(r[2], r[3]); // c2 d2 c3 d3
+  r[0] = _mm_unpacklo_epi64(t0, t1);
+  r[1] = _mm_unpackhi_epi64(t0, t1);
+  r[2] = _mm_unpacklo_epi64(t2, t3);
+  r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+SSE2_TARGET static void square4_sse2(const byte *from, ptrdiff_t from_stride,
+                                     byte *to, ptrdiff_t to_stride) {
+  __m128i r[4];
+  for (int k = 0; k < 4; k++)
+    r[k] = _mm_loadu_si128((const __m128i *)(from + k * from_stride));
+  transpose4_epi32(r);
+  for (int k = 0; k < 4; k++)
+    _mm_storeu_si128((__m128i *)(to + k * to_stride), r[k]);
+}
+
+// A 12-byte pixel is three lanes, so a destination row of four pixels is
+// three registers, put together from the four source pixels with float
+// shuffles (which move bits unchanged).  Each pixel is loaded as 16 bytes
+// ending in the next pixel of its row, except in the last column of the
+// square, where the load starts 4 bytes early and is shifted down, so no
+// load leaves the square
+SSE2_TARGET static void square12_sse2(const byte *from,
+                                      ptrdiff_t from_stride, byte *to,
+                                      ptrdiff_t to_stride) {
+  for (int c = 0; c < 4; c++) {
+    __m128 p[4]; // lanes 0-2 of each are a pixel
+    for (int k = 0; k < 4; k++) {
+      const byte *pixel = from + k * from_stride + c * 12;
+      if (c < 3)
+        p[k] = _mm_loadu_ps((const float *)pixel);
+      else
+        p[k] = _mm_castsi128_ps(_mm_srli_si128(
+                 _mm_loadu_si128((const __m128i *)(pixel - 4)), 4));
+    }
+    __m128 a2b0 = _mm_shuffle_ps(p[0], p[1], _MM_SHUFFLE(0, 0, 2, 2));
+    __m128 c2d0 = _mm_shuffle_ps(p[2], p[3], _MM_SHUFFLE(0, 0, 2, 2));
+    float *row = (float *)(to + c * to_stride);
+    _mm_storeu_ps(row, _mm_shuffle_ps(p[0], a2b0, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(row + 4, _mm_shuffle_ps(p[1], p[2],
+                                          _MM_SHUFFLE(1, 0, 2, 1)));
+    _mm_storeu_ps(row + 8, _mm_shuffle_ps(c2d0, p[3],
+                                          _MM_SHUFFLE(2, 1, 2, 0)));
+  }
+}
+
+SSE2_TARGET static void transpose_sse2(const byte *from,
+                                       ptrdiff_t from_stride, byte *to,
+                                       ptrdiff_t to_stride, int columns,
+                                       int rows, int size) {
+  switch (size) {
+  case 4:  SQUARES(square4_sse2, 4); break;
+  case 12: SQUARES(square12_sse2, 4); break;
+  default:
+    transpose_scalar(from, from_stride, to, to_stride, columns, rows, size);
+    return;
+  }
+  transpose_edges(from, from_stride, to, to_stride, columns, rows, size, 4,
+                  transpose_scalar);
+}
+
+// the 8x8 transpose of 32-bit lanes, as 4x4 transposes within each 128-bit
+// half followed by a swap of the halves
+AVX2_TARGET static inline void transpose8_epi32(__m256i r[8]) {
+  __m256i t[8], u[8];
+  for (int k = 0; k < 8; k += 2) {
+    t[k] = _mm256_unpacklo_epi32(r[k], r[k + 1]);
+    t[k + 1] = _mm256_unpackhi_epi32(r[k], r[k + 1]);
+  }
+  for (int k = 0; k < 8; k += 4) {
+    u[k] = _mm256_unpacklo_epi64(t[k], t[k + 2]);
+    u[k + 1] = _mm256_unpackhi_epi64(t[k], t[k + 2]);
+    u[k + 2] = _mm256_unpacklo_epi64(t[k + 1], t[k + 3]);
+    u[k + 3] = _mm256_unpackhi_epi64(t[k + 1], t[k + 3]);
+  }
+  for (int k = 0; k < 4; k++) {
+    r[k] = _mm256_permute2x128_si256(u[k], u[k + 4], 0x20);
+    r[k + 4] = _mm256_permute2x128_si256(u[k], u[k + 4], 0x31);
+  }
+}
+
+AVX2_TARGET static void square4_avx2(const byte *from, ptrdiff_t from_stride,
+                                     byte *to, ptrdiff_t to_stride) {
+  __m256i r[8];
+  for (int k = 0; k < 8; k++)
+    r[k] = _mm256_loadu_si256((const __m256i *)(from + k * from_stride));
+  transpose8_epi32(r);
+  for (int k = 0; k < 8; k++)
+    _mm256_storeu_si256((__m256i *)(to + k * to_stride), r[k]);
+}
+
+// Eight 3-byte pixels are a row of 24 bytes.  It is loaded as two 16-byte
+// halves that overlap by 8, so that neither leaves the row, and a byte
+// shuffle spreads four pixels from each half into 32-bit lanes.  After the
+// transpose the pixels are packed back into 12 bytes of each half, moved
+// together by a lane permute, and stored as 16 bytes and then 8
+AVX2_TARGET static void square3_avx2(const byte *from, ptrdiff_t from_stride,
+                                     byte *to, ptrdiff_t to_stride) {
+  const __m256i spread = _mm256_setr_epi8(
+    0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+    4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+  const __m256i pack = _mm256_setr_epi8(
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+    0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+  __m256i r[8];
+  for (int k = 0; k < 8; k++) {
+    const byte *row = from + k * from_stride;
+    __m256i v = _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)row)),
+      _mm_loadu_si128((const __m128i *)(row + 8)), 1);
+    r[k] = _mm256_shuffle_epi8(v, spread);
+  }
+  transpose8_epi32(r);
+  for (int k = 0; k < 8; k++) {
+    __m256i v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(r[k], pack),
+                                            join);
+    byte *row = to + k * to_stride;
+    _mm_storeu_si128((__m128i *)row, _mm256_castsi256_si128(v));
+    _mm_storel_epi64((__m128i *)(row + 16), _mm256_extracti128_si256(v, 1));
+  }
+}
+
+// 12-byte pixels already fill the registers of the sse2 kernel, so the
+// avx2 kernel leaves them to it
+AVX2_TARGET static void transpose_avx2(const byte *from,
+                                       ptrdiff_t from_stride, byte *to,
+                                       ptrdiff_t to_stride, int columns,
+                                       int rows, int size) {
+  switch (size) {
+  case 3: SQUARES(square3_avx2, 8); break;
+  case 4: SQUARES(square4_avx2, 8); break;
+  default:
+    transpose_sse2(from, from_stride, to, to_stride, columns, rows, size);
+    return;
+  }
+  transpose_edges(from, from_stride, to, to_stride, columns, rows, size, 8,
+                  transpose_sse2);
+}
+#endif
+
+void Transpose_block(const void *from, ptrdiff_t from_stride, void *to,
+                     ptrdiff_t to_stride, int columns, int rows, int size) {
+  assert(columns >= 0 && rows >= 0 && size > 0);
+  if (columns == 0 || rows == 0)
+    return;
+  assert(from != NULL && to != NULL);
+  switch (Transpose_get_kernel()) {
+#ifdef TRANSPOSE_X86
+  case TRANSPOSE_AVX2:
+    transpose_avx2(from, from_stride, to, to_stride, columns, rows, size);
+    break;
+  case TRANSPOSE_SSE2:
+    transpose_sse2(from, from_stride, to, to_stride, columns, rows, size);
+    break;
+#endif
+  default:
+    transpose_scalar(from, from_stride, to, to_stride, columns, rows, size);
+    break;
+  }
+}
+
+int Transpose_available(Transpose_kernel kernel) {
+  assert(kernel >= 0 && kernel < TRANSPOSE_KERNELS);
+  switch (kernel) {
+  case TRANSPOSE_SCALAR:
+    return 1;
+#ifdef TRANSPOSE_X86
+  case TRANSPOSE_SSE2:
+    return __builtin_cpu_supports("sse2") != 0;
+  case TRANSPOSE_AVX2:
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+  default:
+    return 0;
+  }
+}
+
+int Transpose_set_kernel(Transpose_kernel kernel) {
+  if (!Transpose_available(kernel))
+    return 0;
+  chosen = kernel;
+  return 1;
+}
+
+Transpose_kernel Transpose_get_kernel(void) {
+  if (chosen < 0) {
+    Transpose_kernel kernel = TRANSPOSE_SCALAR;
+    for (int k = TRANSPOSE_KERNELS - 1; k > TRANSPOSE_SCALAR; k--) {
+      if (Transpose_available(k)) {
+        kernel = k;
+        break;
+      }
+    }
+    // an unknown name, or a kernel the CPU lacks, keeps the fastest
+    const char *name = getenv("A2_TRANSPOSE");
+    Transpose_kernel named;
+    if (name != NULL && Transpose_kernel_named(name, &named)
+        && Transpose_available(named))
+      kernel = named;
+    chosen = kernel;
+  }
+  return chosen;
+}
+
+int Transpose_kernel_named(const char *name, Transpose_kernel *kernel) {
+  assert(name != NULL && kernel != NULL);
+  for (int k = 0; k < TRANSPOSE_KERNELS; k++) {
+    if (!strcmp(name, names[k])) {
+      *kernel = k;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+const char *Transpose_name(Transpose_kernel kernel) {
+  assert(kernel >= 0 && kernel < TRANSPOSE_KERNELS);
+  return names[kernel];
+}
@@ -0,0 +1,74 @@
+/***********************************************
+Transpose Kernels
+Spencer Meldrum and Tim Alander
+
+This interface transposes a block of pixels from one buffer into another.
+It is the inner kernel of 90 and 270 degree rotations and of transposes,
+which all send the rows of a tile to the columns of the destination.
+
+There are three kernels.  The scalar kernel copies one pixel at a time and
+runs anywhere.  The sse2 kernel transposes 4x4 squares of 4-byte and
+12-byte (Pnm_rgb) pixels in vector registers.  The avx2 kernel transposes
+8x8 squares of 4-byte pixels, and of 3-byte pixels (a raw 8-bit PPM) with
+byte shuffles, and leaves 12-byte pixels to the sse2 kernel.  Other sizes,
+and the pixels at the edge of a block that do not fill a square, are left
+to a simpler kernel.  The fastest kernel the CPU supports is used unless
+another is chosen.
+***********************************************/
+
+#ifndef TRANSPOSE_INCLUDED
+#define TRANSPOSE_INCLUDED
+
+#include <stddef.h>
+
+typedef enum {
+  TRANSPOSE_SCALAR,
+  TRANSPOSE_SSE2,
+  TRANSPOSE_AVX2,
+  TRANSPOSE_KERNELS // the number of kernels
+} Transpose_kernel;
+
+/***********************************************
+Function: Transpose_block
+Arguments: a source block and the bytes from one of its rows to the next, a
+destination and the same for it, the number of columns and rows in the
+source, and the size of a pixel in bytes
+Purpose: This function copies the pixel in column i and row j of the source
+(at from + j * from_stride + i * size) to column j and row i of the
+destination (at to + i * to_stride + j * size).  Either stride may be
+negative, so a block can be read or written bottom row first, which turns a
+transpose into a rotation.  The blocks must not overlap.
+***********************************************/
+void Transpose_block(const void *from, ptrdiff_t from_stride, void *to,
+                     ptrdiff_t to_stride, int columns, int rows, int size);
+
+/***********************************************
+Function: Transpose_available
+Arguments: a kernel
+Purpose: This function returns 1 if the CPU can run the kernel and 0 if not.
+***********************************************/
+int Transpose_available(Transpose_kernel kernel);
+
+/***********************************************
+Function: Transpose_set_kernel, Transpose_get_kernel
+Arguments: a kernel
+Purpose: These functions choose the kernel used by later calls to
+Transpose_block, and return it.  Transpose_set_kernel returns 0, and
+changes nothing, if the CPU cannot run the kernel.  Until a kernel is
+chosen it is the one named by $A2_TRANSPOSE if the CPU can run it, or else
+the fastest one it can.
+***********************************************/
+int Transpose_set_kernel(Transpose_kernel kernel);
+Transpose_kernel Transpose_get_kernel(void);
+
+/***********************************************
+Function: Transpose_kernel_named, Transpose_name
+Arguments: a name and a pointer to store a kernel through; a kernel
+Purpose: Transpose_kernel_named returns 1 and stores the kernel if the name
+is "scalar", "sse2" or "avx2", and returns 0 otherwise.  Transpose_name
+returns the name of a kernel.
+***********************************************/
+int Transpose_kernel_named(const char *name, Transpose_kernel *kernel);
+const char *Transpose_name(Transpose_kernel kernel);
+
+#endif
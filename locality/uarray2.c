@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "mem.h"
+#include "assert.h"
+#include "bigmem.h"
+#include "uarray2.h"
+
+// the recursive transpose copies directly once a piece is this many
+// elements (or fewer) on each side
+#define TRANSPOSE_LEAF 16
+// the tiled column-major map buffers this many bytes of every row at once
+#define BAND_BYTES 64
+
+struct UArray2_T {
+  // must come first, for UArray2_view_ref.  base is the elements, row
+  // after row, from Bigmem_alloc
+  UArray2_view view;
+  size_t linear_Bytes; // size of the linear representation, for Bigmem_free
+};
+
+
+UArray2_T UArray2_new(int columns, int rows, int size){
+  UArray2_T newArray = NEW(newArray);
+  newArray->linear_Bytes=(size_t)columns*rows*size;
+  newArray->view.rows=rows;
+  newArray->view.columns=columns;
+  newArray->view.size=size;
+  newArray->view.base=Bigmem_alloc(newArray->linear_Bytes);
+  return newArray;
+}
+
+void* UArray2_at(UArray2_T t, int column, int row){
+  assert(t!=NULL);
+  int temp_column=t->view.columns; // temporary variable to store total number
+  // of columns in the array provided
+  assert(column>=0 && column<temp_column && row>=0 && row<t->view.rows);
+  
+  // converts 2D coordinate into linear index and returns value
+  return t->view.base+((size_t)row*temp_column+column)*t->view.size;
+}
+
+
+UArray2_view UArray2_view_of(UArray2_T t){
+  assert(t!=NULL);
+  return t->view;
+}
+
+
+int UArray2_Rows(UArray2_T t){
+  assert(t!=NULL);
+  return t->view.rows;
+}
+
+
+int UArray2_Columns(UArray2_T t){
+  assert(t!=NULL);
+  return t->view.columns;
+}
+
+
+int UArray2_length(UArray2_T t){
+  assert(t!=NULL);
+  int columns=t->view.columns;
+  int rows=t->view.rows;
+  return columns*rows;
+}
+
+
+void UArray2_map_column_major(UArray2_T t, void apply(void* element, void* cl), 
+  void *cl){
+  assert(t!=NULL);
+  int max_Row=(t->view.rows);
+  int max_Column=(t->view.columns);
+  UArray2_view view=UArray2_view_of(t);
+  for(int i=0; i<max_Column; i++){
+    for(int k=0;k<max_Row; k++){
+      apply(UArray2_view_at(&view, i, k), cl);
+    }
+  }
+  (void)cl;
+  
+}
+
+
+// copies a small rows x columns block into its transpose.  The element size
+// is passed as a constant for the common sizes, so each copy becomes a
+// single move instead of a call to memcpy
+#define TRANSPOSE_LEAF_COPY(SIZE) \
+  for(int k=0; k<rows; k++){ \
+    const char *in=from+k*from_Stride; \
+    char *out=to+(size_t)k*(SIZE); \
+    for(int i=0; i<columns; i++){ \
+      memcpy(out, in, (SIZE)); \
+      in+=(SIZE); \
+      out+=to_Stride; \
+    } \
+  }
+
+
+static void transpose_leaf(const char *from, size_t from_Stride, char *to,
+  size_t to_Stride, int rows, int columns, int size){
+  switch(size){
+  case 1: TRANSPOSE_LEAF_COPY(1) break;
+  case 2: TRANSPOSE_LEAF_COPY(2) break;
+  case 4: TRANSPOSE_LEAF_COPY(4) break;
+  case 8: TRANSPOSE_LEAF_COPY(8) break;
+  case 12: TRANSPOSE_LEAF_COPY(12) break; // a Pnm_rgb
+  default: TRANSPOSE_LEAF_COPY(size) break;
+  }
+}
+
+
+// transposes the rows x columns block at from into the columns x rows block
+// at to.  Strides are the bytes from one row of a block to the next
+static void transpose_block(const char *from, size_t from_Stride, char *to,
+  size_t to_Stride, int rows, int columns, int size){
+  if(rows<=TRANSPOSE_LEAF && columns<=TRANSPOSE_LEAF){
+    transpose_leaf(from, from_Stride, to, to_Stride, rows, columns, size);
+  } else if(rows>=columns){
+    // the top rows become the left columns of the destination
+    int half=rows/2;
+    transpose_block(from, from_Stride, to, to_Stride, half, columns, size);
+    transpose_block(from+half*from_Stride, from_Stride,
+      to+(size_t)half*size, to_Stride, rows-half, columns, size);
+  } else {
+    // the left columns become the top rows of the destination
+    int half=columns/2;
+    transpose_block(from, from_Stride, to, to_Stride, rows, half, size);
+    transpose_block(from+(size_t)half*size, from_Stride,
+      to+half*to_Stride, to_Stride, rows, columns-half, size);
+  }
+}
+
+
+void UArray2_transpose(UArray2_T source, UArray2_T destination){
+  assert(source!=NULL && destination!=NULL);
+  assert(destination->view.columns==source->view.rows);
+  assert(destination->view.rows==source->view.columns);
+  assert(destination->view.size==source->view.size);
+  int size=source->view.size;
+  transpose_block(source->view.base,
+    (size_t)source->view.columns*size, destination->view.base,
+    (size_t)destination->view.columns*size, source->view.rows,
+    source->view.columns, size);
+}
+
+
+void UArray2_map_column_major_tiled(UArray2_T t, void apply(void* element,
+void* cl), void *cl){
+  assert(t!=NULL);
+  int rows=t->view.rows;
+  int columns=t->view.columns;
+  int size=t->view.size;
+  if(rows==0 || columns==0){
+    return;
+  }
+  int band=BAND_BYTES/size>0 ? BAND_BYTES/size : 1;
+  if(band>columns){
+    band=columns;
+  }
+  size_t row_Bytes=(size_t)columns*size;
+  // buffered columns are padded by a cache line so that a power-of-two
+  // height does not put every column in the same cache sets
+  size_t column_Bytes=(size_t)rows*size+BAND_BYTES;
+  char *buffer=ALLOC(band*column_Bytes);
+  for(int first=0; first<columns; first+=band){
+    int width=columns-first<band ? columns-first : band;
+    char *start=t->view.base+(size_t)first*size;
+    // each buffered column is contiguous, so apply walks memory in order
+    transpose_block(start, row_Bytes, buffer, column_Bytes, rows, width,
+      size);
+    for(int i=0; i<width; i++){
+      char *element=buffer+i*column_Bytes;
+      for(int k=0; k<rows; k++){
+        apply(element, cl);
+        element+=size;
+      }
+    }
+    transpose_block(buffer, column_Bytes, start, row_Bytes, width, rows,
+      size);
+  }
+  FREE(buffer);
+}
+
+
+void UArray2_map_row_major(UArray2_T t, void apply(void* element, void* cl),
+void *cl){
+  assert(t!=NULL);
+  int length=UArray2_length(t); // fixed for the life of the array
+  char *element=t->view.base;
+  for(int i=0; i<length; i++){
+    apply(element, cl);
+    element+=t->view.size;
+  }
+}
+
+
+void *UArray2_row(UArray2_T t, int row, int *length){
+  assert(t!=NULL);
+  assert(row>=0 && row<t->view.rows);
+  if(length!=NULL){
+    *length=t->view.columns;
+  }
+  return t->view.base+(size_t)row*t->view.columns*t->view.size;
+}
+
+
+void UArray2_map_rows(UArray2_T t, void apply(int row, void *elements,
+int count, void *cl), void *cl){
+  assert(t!=NULL);
+  size_t row_Bytes=(size_t)t->view.columns*t->view.size;
+  for(int k=0; k<t->view.rows; k++){
+    apply(k, t->view.base+k*row_Bytes, t->view.columns, cl);
+  }
+}
+
+
+void UArray2_reshape(UArray2_T t, int columns, int rows){
+  assert(t!=NULL);
+  assert(columns>=0 && rows>=0);
+  assert((long)columns*rows==(long)t->view.columns*t->view.rows);
+  t->view.columns=columns;
+  t->view.rows=rows;
+}
+
+
+void UArray2_free(UArray2_T t){
+  assert(t!=NULL);
+  Bigmem_free(t->view.base, t->linear_Bytes);
+  free(t);
+}
+
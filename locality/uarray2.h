@@ -0,0 +1,238 @@
+/***********************************************
+Unboxed 2-D Array (UArray2_T)
+Spencer Meldrum and Tim Alander
+
+This data structure is an array capable of storing unboxed elements
+(meaning actual data elements, not simply pointers to data elements).
+Each element stored in the array is given an x and y coordinate within
+the interface. (these x and y coordinates are refered to as columns and rows
+in this implementation)
+
+For example, an element stored in xy coordinate 3,2 would be stored in the
+third column, two rows down.
+
+The elements are stored row after row in one block of memory from
+Bigmem_alloc, so every row starts right after the one before it, the block
+starts on a cache line, and a large array can be backed by huge pages as
+the page policy in bigmem.h says.
+
+UArray2_at is a function call that always checks its indices.  Code that
+touches every element can instead take a UArray2_view, which caches the
+address of the first element, the row length and the element size, and use
+UArray2_view_at.  That is inlined into the caller and is a multiply and an
+add.  It checks its indices too, unless the program is compiled with
+-DUARRAY2_UNCHECKED.
+***********************************************/
+
+#ifndef UARRAY2_T_INCLUDED
+#define UARRAY2_T_INCLUDED
+
+#include <stddef.h>
+#include "assert.h"
+
+typedef struct UArray2_T *UArray2_T;
+
+typedef struct UArray2_view{
+  char *base; //the element at column 0, row 0, or NULL if there are none
+  int columns;
+  int rows;
+  int size;
+} UArray2_view;
+
+/***********************************************
+Function: UArray2_new
+Arguments: 3 integers: columns and rows (when multiplied) represent the total
+number of elements that can be stored in the created array. The size integer
+represents the size in bytes that a data element will occupy.
+Purpose: This function creates a UArray2_T  of the user specified number of
+columns and rows, and returns a pointer to the array.
+***********************************************/
+UArray2_T UArray2_new(int columns, int rows, int size);
+
+
+/***********************************************
+Function: UArray2_at
+Arguments: -A pointer to the array on which the function will act.
+- column and row indices that correspond to a data element within the array.
+Purpose: This function returns a pointer to a data element that is stored at the
+column and row indices supplied, even if there is no data stored there at the
+time of the function call.
+***********************************************/
+void* UArray2_at(UArray2_T t, int column, int row);
+
+
+/***********************************************
+Function: UArray2_Rows
+Arguments: A pointer to a UArray2_T
+Purpose: This function returns an integer corresponding to the number of rows
+in the given array. It is a c.r.e for the pointer to be NULL.
+***********************************************/
+int UArray2_Rows(UArray2_T t);
+
+
+/***********************************************
+Function: UArray2_Columns
+Arguments: A pointer to a UArray2_T
+Purpose: This function returns an integer corresponding to the number of columns
+in the given array. It is a c.r.e for the pointer to be NULL.
+***********************************************/
+int UArray2_Columns(UArray2_T t);
+
+
+/***********************************************
+Function: UArray2_length
+Arguments: A pointer to a UArray2_T
+Purpose: This function returns an integer corresponding to total number of 
+elements in the given array. It is a c.r.e for the pointer to be NULL.
+***********************************************/
+int UArray2_length(UArray2_T t);
+
+
+/***********************************************
+Function: UArray2_map_column_major
+Arguments: -A pointer to a UArray2_T
+-An apply function
+-A pointer to a closure element
+Purpose: This function calls the apply function provided on every element in the
+array provided. The row indices will vary more quickly than the column indices.
+***********************************************/
+void UArray2_map_column_major(UArray2_T t, void apply(void* element, void* cl),
+void *cl);
+
+
+/***********************************************
+Function: UArray2_map_column_major_tiled
+Arguments: -A pointer to a UArray2_T
+-An apply function
+-A pointer to a closure element
+Purpose: This function visits the elements in exactly the same order as
+UArray2_map_column_major, but much faster on arrays bigger than the cache.
+It copies a band of columns (one cache line of each row) into a buffer laid
+out column by column, calls apply on the buffered copies and then copies the
+band back.  Changes apply makes to its element are kept, but apply must not
+reach the array's other elements any other way while mapping.
+***********************************************/
+void UArray2_map_column_major_tiled(UArray2_T t, void apply(void* element,
+void* cl), void *cl);
+
+
+/***********************************************
+Function: UArray2_transpose
+Arguments: -A pointer to the source UArray2_T
+-A pointer to the destination UArray2_T
+Purpose: This function copies the element at (column, row) of the source
+to (row, column) of the destination.  It splits the larger dimension in
+half recursively until the pieces are small, so at some level of the
+recursion both halves fit in each level of cache, whatever its size.  It
+is a c.r.e for the destination not to have as many columns as the source
+has rows and as many rows as it has columns, or for the element sizes to
+differ.
+***********************************************/
+void UArray2_transpose(UArray2_T source, UArray2_T destination);
+
+
+/***********************************************
+Function: UArray2_map_row_major
+Arguments: -A pointer to a UArray2_T
+-An apply function
+-A pointer to a closure element
+Purpose: This function calls the apply function provided on every element in the
+array provided. The column indices will vary more quickly than the row indices.
+***********************************************/
+void UArray2_map_row_major(UArray2_T t, void apply(void* element, void* cl),
+void *cl);
+
+/***********************************************
+Function: UArray2_row
+Arguments: -A pointer to a UArray2_T
+-A row index
+-A pointer to an integer, which may be NULL
+Purpose: This function returns a pointer to the first element of the given
+row.  The elements of a row are contiguous, so element i of the row is at
+that pointer plus i times the element size.  If length is not NULL the
+number of elements in the row is stored there.  It is a c.r.e for the row
+to be out of bounds.
+***********************************************/
+void *UArray2_row(UArray2_T t, int row, int *length);
+
+
+/***********************************************
+Function: UArray2_map_rows
+Arguments: -A pointer to a UArray2_T
+-An apply function
+-A pointer to a closure element
+Purpose: This function calls the apply function once per row, from the top
+row down, with the row index, a pointer to the row's contiguous elements and
+how many there are.  Doing a whole row per call lets apply run a plain loop
+over memory, which the compiler can unroll or vectorise, instead of taking
+one call per element.
+***********************************************/
+void UArray2_map_rows(UArray2_T t, void apply(int row, void *elements,
+int count, void *cl), void *cl);
+
+
+/***********************************************
+Function: UArray2_reshape
+Arguments: -A pointer to a UArray2_T
+-A new number of columns and rows
+Purpose: This function changes the shape of the array without moving any
+element, so the element that was at linear position k in row-major order
+is at linear position k in the new shape.  This lets an algorithm that
+rearranges the elements itself, such as an in-place rotation, give the
+array its new dimensions.  It is a c.r.e for columns times rows to differ
+from the length of the array.
+***********************************************/
+void UArray2_reshape(UArray2_T t, int columns, int rows);
+
+
+/***********************************************
+Function: UArray2_view_of
+Arguments: A pointer to a UArray2_T
+Purpose: This function returns a view of the array for UArray2_view_at.
+The view stays good until the array is freed.
+***********************************************/
+UArray2_view UArray2_view_of(UArray2_T t);
+
+
+/***********************************************
+Function: UArray2_view_ref
+Arguments: A pointer to a UArray2_T
+Purpose: This function returns a pointer to the array's own view, which an
+array keeps at its start.  Unlike UArray2_view_of it is inlined, so code
+that is handed the array afresh on every call, such as an A2Methods at
+function, reaches an element without a second call.  The view follows the
+array through UArray2_reshape.
+***********************************************/
+static inline const UArray2_view *UArray2_view_ref(UArray2_T t){
+  assert(t!=NULL);
+  return (const UArray2_view *)(const void *)t;
+}
+
+
+/***********************************************
+Function: UArray2_view_at
+Arguments: -A pointer to a view of an array.
+- column and row indices that correspond to a data element within the array.
+Purpose: This function returns a pointer to the data element at the column
+and row indices supplied, just like UArray2_at but without a function call.
+Unless UARRAY2_UNCHECKED is defined it is a c.r.e for the indices to be out
+of bounds.
+***********************************************/
+static inline void *UArray2_view_at(const UArray2_view *v, int column,
+  int row){
+#ifndef UARRAY2_UNCHECKED
+  assert(column>=0 && column<v->columns && row>=0 && row<v->rows);
+#endif
+  return v->base + ((size_t)row*v->columns + column)*v->size;
+}
+
+
+/***********************************************
+Function: UArray2_free
+Arguments: -A pointer to a UArray2_T
+Purpose: This function frees the array and gives its elements' memory back
+through Bigmem_free.
+***********************************************/
+void UArray2_free(UArray2_T t);
+
+#endif
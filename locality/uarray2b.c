@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <math.h>
+#include "mem.h"
+#include "assert.h"
+#include "bigmem.h"
+#include "uarray2b.h"
+
+// the size new_64K_block fits each block into
+#define BLOCK_BYTES (64 * 1024)
+
+struct UArray2b_T {
+  UArray2b_view view; // must come first, for UArray2b_view_ref
+  size_t cells_Bytes; // as given to Bigmem_alloc
+};
+
+
+UArray2b_T UArray2b_new(int width, int height, int size, int blocksize){
+  assert(width>=0 && height>=0 && size>0 && blocksize>0);
+  UArray2b_T array2b;
+  NEW(array2b);
+  array2b->view.width=width;
+  array2b->view.height=height;
+  array2b->view.size=size;
+  array2b->view.blocksize=blocksize;
+  array2b->view.blocks_Wide=(width+blocksize-1)/blocksize;
+  int blocks_High=(height+blocksize-1)/blocksize;
+  // every block starts on a cache line, so no line holds two blocks
+  size_t block_Bytes=(size_t)blocksize*blocksize*size;
+  array2b->view.block_Bytes=(block_Bytes+BIGMEM_CACHE_LINE-1)
+    /BIGMEM_CACHE_LINE*BIGMEM_CACHE_LINE;
+  array2b->cells_Bytes=(size_t)array2b->view.blocks_Wide*blocks_High
+    *array2b->view.block_Bytes;
+  array2b->view.cells=Bigmem_alloc(array2b->cells_Bytes);
+  return array2b;
+}
+
+
+UArray2b_T UArray2b_new_64K_block(int width, int height, int size){
+  assert(size>0);
+  int blocksize=(int)sqrt((double)BLOCK_BYTES/size);
+  return UArray2b_new(width, height, size, blocksize>0 ? blocksize : 1);
+}
+
+
+void UArray2b_free(UArray2b_T *array2b){
+  assert(array2b!=NULL && *array2b!=NULL);
+  Bigmem_free((*array2b)->view.cells, (*array2b)->cells_Bytes);
+  FREE(*array2b);
+}
+
+
+int UArray2b_width(UArray2b_T array2b){
+  assert(array2b!=NULL);
+  return array2b->view.width;
+}
+
+
+int UArray2b_height(UArray2b_T array2b){
+  assert(array2b!=NULL);
+  return array2b->view.height;
+}
+
+
+int UArray2b_size(UArray2b_T array2b){
+  assert(array2b!=NULL);
+  return array2b->view.size;
+}
+
+
+int UArray2b_blocksize(UArray2b_T array2b){
+  assert(array2b!=NULL);
+  return array2b->view.blocksize;
+}
+
+
+void *UArray2b_at(UArray2b_T array2b, int i, int j){
+  assert(array2b!=NULL);
+  const UArray2b_view *v=&array2b->view;
+  assert(i>=0 && i<v->width && j>=0 && j<v->height);
+  int bs=v->blocksize;
+  size_t block=(size_t)(j/bs)*v->blocks_Wide+i/bs;
+  size_t cell=(j%bs)*bs+i%bs;
+  return v->cells+block*v->block_Bytes+cell*v->size;
+}
+
+
+int UArray2b_blocks(UArray2b_T array2b){
+  assert(array2b!=NULL);
+  int bs=array2b->view.blocksize;
+  return array2b->view.blocks_Wide*((array2b->view.height+bs-1)/bs);
+}
+
+
+void UArray2b_map_block(UArray2b_T array2b, int block,
+  void apply(int i, int j, UArray2b_T array2b, void *elem, void *cl),
+  void *cl){
+  assert(array2b!=NULL);
+  assert(block>=0 && block<UArray2b_blocks(array2b));
+  const UArray2b_view *v=&array2b->view;
+  int bs=v->blocksize;
+  int bi=block%v->blocks_Wide*bs;
+  int bj=block/v->blocks_Wide*bs;
+  // clip the block to the array, since edge blocks may overhang it
+  int rows=v->height-bj<bs ? v->height-bj : bs;
+  int columns=v->width-bi<bs ? v->width-bi : bs;
+  char *first=v->cells+(size_t)block*v->block_Bytes;
+  for(int y=0; y<rows; y++){
+    char *elem=first+(size_t)y*bs*v->size;
+    for(int x=0; x<columns; x++){
+      apply(bi+x, bj+y, array2b, elem, cl);
+      elem+=v->size;
+    }
+  }
+}
+
+
+void UArray2b_map(UArray2b_T array2b,
+  void apply(int i, int j, UArray2b_T array2b, void *elem, void *cl),
+  void *cl){
+  assert(array2b!=NULL);
+  int blocks=UArray2b_blocks(array2b);
+  for(int block=0; block<blocks; block++){
+    UArray2b_map_block(array2b, block, apply, cl);
+  }
+}
+
+
+void UArray2b_map_spans(UArray2b_T array2b,
+  void apply(int i, int j, void *elements, int count, void *cl),
+  void *cl){
+  assert(array2b!=NULL);
+  const UArray2b_view *v=&array2b->view;
+  int bs=v->blocksize;
+  int blocks=UArray2b_blocks(array2b);
+  for(int block=0; block<blocks; block++){
+    int bi=block%v->blocks_Wide*bs;
+    int bj=block/v->blocks_Wide*bs;
+    int rows=v->height-bj<bs ? v->height-bj : bs;
+    int columns=v->width-bi<bs ? v->width-bi : bs;
+    char *first=v->cells+(size_t)block*v->block_Bytes;
+    for(int y=0; y<rows; y++){
+      apply(bi, bj+y, first+(size_t)y*bs*v->size, columns, cl);
+    }
+  }
+}
@@ -0,0 +1,142 @@
+/***********************************************
+Blocked 2-D Array (UArray2b_T)
+Spencer Meldrum and Tim Alander
+
+This data structure stores unboxed elements like UArray2_T, but instead of
+keeping each row together it cuts the array into square blocks of
+blocksize x blocksize elements and keeps each block together.  Elements
+that are near each other in both directions are therefore near each other
+in memory, which is what an algorithm that moves across rows and down
+columns at the same time (such as a rotation) wants.
+
+Coordinates are (i, j), with i the column and j the row, as in A2Methods.
+The blocks along the right and bottom edges may be partly outside the
+array; those cells take up memory but are never visited.
+***********************************************/
+
+#ifndef UARRAY2B_INCLUDED
+#define UARRAY2B_INCLUDED
+
+#include <stddef.h>
+#include "assert.h"
+
+typedef struct UArray2b_T *UArray2b_T;
+
+// the layout of an array, for code that finds elements itself
+typedef struct UArray2b_view {
+  char *cells; // every block, one after another, each in row-major order
+  size_t block_Bytes; // a block rounded up to whole cache lines
+  int width;
+  int height;
+  int size;
+  int blocksize;
+  int blocks_Wide; // number of blocks across one row of blocks
+} UArray2b_view;
+
+/***********************************************
+Function: UArray2b_new
+Arguments: the width and height of the array in elements, the size of an
+element in bytes and the number of elements along each side of a block
+Purpose: This function allocates a blocked array with every element zeroed.
+It is a c.r.e for the blocksize to be less than 1.
+***********************************************/
+UArray2b_T UArray2b_new(int width, int height, int size, int blocksize);
+
+/***********************************************
+Function: UArray2b_new_64K_block
+Arguments: the width and height of the array and the size of an element
+Purpose: This function allocates a blocked array whose blocks are as large
+as possible while still fitting in 64KB.  An element bigger than 64KB gets
+a blocksize of 1.
+***********************************************/
+UArray2b_T UArray2b_new_64K_block(int width, int height, int size);
+
+/***********************************************
+Function: UArray2b_free
+Arguments: A pointer to a UArray2b_T
+Purpose: This function frees the array and sets *array2b to NULL.
+***********************************************/
+void UArray2b_free(UArray2b_T *array2b);
+
+/***********************************************
+Function: UArray2b_width, UArray2b_height, UArray2b_size, UArray2b_blocksize
+Arguments: A UArray2b_T
+Purpose: These functions return the width, height, element size and
+blocksize the array was created with.
+***********************************************/
+int UArray2b_width(UArray2b_T array2b);
+int UArray2b_height(UArray2b_T array2b);
+int UArray2b_size(UArray2b_T array2b);
+int UArray2b_blocksize(UArray2b_T array2b);
+
+/***********************************************
+Function: UArray2b_at
+Arguments: A UArray2b_T and the column and row of an element
+Purpose: This function returns a pointer to the element.  It is a c.r.e for
+the coordinates to be out of bounds.
+***********************************************/
+void *UArray2b_at(UArray2b_T array2b, int i, int j);
+
+/***********************************************
+Function: UArray2b_view_ref
+Arguments: A UArray2b_T
+Purpose: This function returns a pointer to the layout of the array, which
+an array keeps at its start.  It is inlined, so code that is handed the
+array afresh on every call, such as an A2Methods at function, can find an
+element without calling UArray2b_at.  Element (i, j) is in block
+(j / blocksize) * blocks_Wide + i / blocksize, which starts at cells plus
+that many block_Bytes, at position (j % blocksize) * blocksize + i %
+blocksize within the block.
+***********************************************/
+static inline const UArray2b_view *UArray2b_view_ref(UArray2b_T array2b){
+  assert(array2b!=NULL);
+  return (const UArray2b_view *)(const void *)array2b;
+}
+
+/***********************************************
+Function: UArray2b_map
+Arguments: A UArray2b_T, an apply function and a closure
+Purpose: This function calls apply on every element, one block at a time.
+The blocks are visited in row-major order and so are the elements inside
+each block, so every element of a block is visited before any element of
+the next.
+***********************************************/
+void UArray2b_map(UArray2b_T array2b,
+  void apply(int i, int j, UArray2b_T array2b, void *elem, void *cl),
+  void *cl);
+
+/***********************************************
+Function: UArray2b_blocks
+Arguments: A UArray2b_T
+Purpose: This function returns the number of blocks in the array, counting
+the blocks along the right and bottom edges that are only partly used.
+Blocks are numbered in row-major order from 0.
+***********************************************/
+int UArray2b_blocks(UArray2b_T array2b);
+
+/***********************************************
+Function: UArray2b_map_block
+Arguments: A UArray2b_T, a block number, an apply function and a closure
+Purpose: This function calls apply on every element of one block, in
+row-major order within the block.  Blocks share no elements, so different
+blocks may be mapped by different threads at the same time.  It is a c.r.e
+for the block number to be out of range.
+***********************************************/
+void UArray2b_map_block(UArray2b_T array2b, int block,
+  void apply(int i, int j, UArray2b_T array2b, void *elem, void *cl),
+  void *cl);
+
+/***********************************************
+Function: UArray2b_map_spans
+Arguments: A UArray2b_T, an apply function and a closure
+Purpose: This function visits the elements in the same order as
+UArray2b_map, but calls apply once for each row of each block with the
+column and row of the first element, a pointer to it and the number of
+elements in the row of the block.  Those elements are next to each other
+in memory.  Rows of blocks on the right edge stop at the edge of the array.
+***********************************************/
+void UArray2b_map_spans(UArray2b_T array2b,
+  void apply(int i, int j, void *elements, int count, void *cl),
+  void *cl);
+
+#endif
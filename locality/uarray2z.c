@@ -0,0 +1,167 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "mem.h"
+#include "assert.h"
+#include "bigmem.h"
+#include "uarray2z.h"
+
+// squares of this side or smaller are mapped by walking their cells in
+// memory order rather than by splitting them further
+#define LEAF_SIDE 8
+
+struct UArray2z_T {
+  char *cells; // the squares, one after another, each in Z-order
+  size_t cells_Bytes; // as given to Bigmem_alloc
+  int width;
+  int height;
+  int size;
+  int shift; // log2 of the side of a square
+  // the parts of the Z-index contributed by each column and each row, so
+  // that at needs two loads and an add instead of interleaving bits
+  uint64_t *column_Bits;
+  uint64_t *row_Bits;
+};
+
+#define EVEN_BITS 0x5555555555555555ULL
+
+// spreads the bits of x out to the even bit positions
+static inline uint64_t spread(uint32_t x){
+  uint64_t v=x;
+  v=(v | v<<16) & 0x0000FFFF0000FFFFULL;
+  v=(v | v<<8) & 0x00FF00FF00FF00FFULL;
+  v=(v | v<<4) & 0x0F0F0F0F0F0F0F0FULL;
+  v=(v | v<<2) & 0x3333333333333333ULL;
+  v=(v | v<<1) & EVEN_BITS;
+  return v;
+}
+
+// gathers the even bit positions of z back into one number
+static inline uint32_t compact(uint64_t z){
+  uint64_t v=z & EVEN_BITS;
+  v=(v | v>>1) & 0x3333333333333333ULL;
+  v=(v | v>>2) & 0x0F0F0F0F0F0F0F0FULL;
+  v=(v | v>>4) & 0x00FF00FF00FF00FFULL;
+  v=(v | v>>8) & 0x0000FFFF0000FFFFULL;
+  v=(v | v>>16) & 0x00000000FFFFFFFFULL;
+  return (uint32_t)v;
+}
+
+// the part of the Z-index that coordinate x contributes, where x takes the
+// even bits (odd is 0) or the odd bits (odd is 1) within a square.  The
+// number of the square goes above the bits of both; squares are only laid
+// along one axis, and along the other x is always inside the first square
+static uint64_t z_bits(int x, int shift, int odd){
+  uint32_t mask=((uint32_t)1<<shift)-1;
+  uint64_t square=(uint64_t)(x>>shift);
+  return square<<(2*shift) | spread(x & mask)<<odd;
+}
+
+
+UArray2z_T UArray2z_new(int width, int height, int size){
+  assert(width>=0 && height>=0 && size>0);
+  UArray2z_T array2z;
+  NEW(array2z);
+  array2z->width=width;
+  array2z->height=height;
+  array2z->size=size;
+  int shorter=width<height ? width : height;
+  int longer=width<height ? height : width;
+  array2z->shift=0;
+  while((1L<<array2z->shift)<shorter){
+    array2z->shift++;
+  }
+  long side=1L<<array2z->shift;
+  long squares=shorter>0 ? (longer+side-1)/side : 0;
+  array2z->cells_Bytes=(size_t)squares*side*side*size;
+  array2z->cells=Bigmem_alloc(array2z->cells_Bytes);
+  array2z->column_Bits=ALLOC((width+1)*(long)sizeof(uint64_t));
+  array2z->row_Bits=ALLOC((height+1)*(long)sizeof(uint64_t));
+  for(int i=0; i<width; i++){
+    array2z->column_Bits[i]=z_bits(i, array2z->shift, 0);
+  }
+  for(int j=0; j<height; j++){
+    array2z->row_Bits[j]=z_bits(j, array2z->shift, 1);
+  }
+  return array2z;
+}
+
+
+void UArray2z_free(UArray2z_T *array2z){
+  assert(array2z!=NULL && *array2z!=NULL);
+  Bigmem_free((*array2z)->cells, (*array2z)->cells_Bytes);
+  FREE((*array2z)->column_Bits);
+  FREE((*array2z)->row_Bits);
+  FREE(*array2z);
+}
+
+
+int UArray2z_width(UArray2z_T array2z){
+  assert(array2z!=NULL);
+  return array2z->width;
+}
+
+
+int UArray2z_height(UArray2z_T array2z){
+  assert(array2z!=NULL);
+  return array2z->height;
+}
+
+
+int UArray2z_size(UArray2z_T array2z){
+  assert(array2z!=NULL);
+  return array2z->size;
+}
+
+
+void *UArray2z_at(UArray2z_T array2z, int i, int j){
+  assert(array2z!=NULL);
+  assert(i>=0 && i<array2z->width && j>=0 && j<array2z->height);
+  uint64_t z=array2z->column_Bits[i]+array2z->row_Bits[j];
+  return array2z->cells+z*array2z->size;
+}
+
+
+// maps the square of the given side whose top left corner is (x, y) and
+// whose first cell has Z-index z
+static void map_square(UArray2z_T a, int x, int y, long side, uint64_t z,
+  void apply(int i, int j, UArray2z_T array2z, void *elem, void *cl),
+  void *cl){
+  if(x>=a->width || y>=a->height){
+    return;
+  }
+  if(side<=LEAF_SIDE){
+    char *elem=a->cells+z*a->size;
+    for(uint64_t k=0; k<(uint64_t)(side*side); k++, elem+=a->size){
+      int i=x+compact(k);
+      int j=y+compact(k>>1);
+      if(i<a->width && j<a->height){
+        apply(i, j, a, elem, cl);
+      }
+    }
+    return;
+  }
+  long half=side/2;
+  uint64_t quarter=(uint64_t)(half*half);
+  map_square(a, x, y, half, z, apply, cl);
+  map_square(a, x+half, y, half, z+quarter, apply, cl);
+  map_square(a, x, y+half, half, z+2*quarter, apply, cl);
+  map_square(a, x+half, y+half, half, z+3*quarter, apply, cl);
+}
+
+
+void UArray2z_map(UArray2z_T array2z,
+  void apply(int i, int j, UArray2z_T array2z, void *elem, void *cl),
+  void *cl){
+  assert(array2z!=NULL);
+  long side=1L<<array2z->shift;
+  int along_x=array2z->width>=array2z->height;
+  int longer=along_x ? array2z->width : array2z->height;
+  if(array2z->width==0 || array2z->height==0){
+    return;
+  }
+  for(long s=0; s*side<longer; s++){
+    int x=along_x ? s*side : 0;
+    int y=along_x ? 0 : s*side;
+    map_square(array2z, x, y, side, (uint64_t)s*side*side, apply, cl);
+  }
+}
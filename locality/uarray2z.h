@@ -0,0 +1,75 @@
+/***********************************************
+Z-Order 2-D Array (UArray2z_T)
+Spencer Meldrum and Tim Alander
+
+This data structure stores unboxed elements in Z-order (Morton order).  The
+index of element (i, j) interleaves the bits of i and j, so every aligned
+2^k x 2^k square of elements is contiguous in memory at every k at once.
+An algorithm that moves across rows and down columns together, such as a
+rotation, gets cache-sized blocks for every cache level without a
+blocksize being chosen.
+
+The array is made of squares whose side S is the smallest power of two at
+least as large as the shorter dimension, laid end to end along the longer
+one.  Cells outside the array take up memory but are never visited, which
+costs up to 4x the memory of a plain array in the worst case (sides just
+over a power of two) and much less for typical image sizes.
+
+Coordinates are (i, j), with i the column and j the row, as in A2Methods.
+The bits each column and each row contribute to an index are worked out
+once, when the array is made, so UArray2z_at adds two table entries.
+Interleaving and de-interleaving bits, for those tables and for mapping,
+is done with shifts and masks.  Mapping only de-interleaves indices within
+a small leaf square, so faster bit instructions would gain nothing there.
+***********************************************/
+
+#ifndef UARRAY2Z_INCLUDED
+#define UARRAY2Z_INCLUDED
+
+typedef struct UArray2z_T *UArray2z_T;
+
+/***********************************************
+Function: UArray2z_new
+Arguments: the width and height of the array in elements and the size of
+an element in bytes
+Purpose: This function allocates a Z-order array with every element zeroed.
+***********************************************/
+UArray2z_T UArray2z_new(int width, int height, int size);
+
+/***********************************************
+Function: UArray2z_free
+Arguments: A pointer to a UArray2z_T
+Purpose: This function frees the array and sets *array2z to NULL.
+***********************************************/
+void UArray2z_free(UArray2z_T *array2z);
+
+/***********************************************
+Function: UArray2z_width, UArray2z_height, UArray2z_size
+Arguments: A UArray2z_T
+Purpose: These functions return the width, height and element size the
+array was created with.
+***********************************************/
+int UArray2z_width(UArray2z_T array2z);
+int UArray2z_height(UArray2z_T array2z);
+int UArray2z_size(UArray2z_T array2z);
+
+/***********************************************
+Function: UArray2z_at
+Arguments: A UArray2z_T and the column and row of an element
+Purpose: This function returns a pointer to the element.  It is a c.r.e for
+the coordinates to be out of bounds.
+***********************************************/
+void *UArray2z_at(UArray2z_T array2z, int i, int j);
+
+/***********************************************
+Function: UArray2z_map
+Arguments: A UArray2z_T, an apply function and a closure
+Purpose: This function calls apply on every element in Z-order, which is
+the order they sit in memory.  Squares that lie wholly outside the array
+are skipped without being visited.
+***********************************************/
+void UArray2z_map(UArray2z_T array2z,
+  void apply(int i, int j, UArray2z_T array2z, void *elem, void *cl),
+  void *cl);
+
+#endif
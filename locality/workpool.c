@@ -0,0 +1,125 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "mem.h"
+#include "assert.h"
+#include "workpool.h"
+
+// A share is the range [lo, hi) of task numbers a thread still has to do,
+// packed into one word so that it can be claimed with a single CAS: the
+// owner moves lo up, and a thief moves hi down.  lo only ever grows, so a
+// share never returns to an earlier value and a stale CAS simply fails.
+typedef uint64_t share;
+
+static inline share pack(uint32_t lo, uint32_t hi) {
+  return (uint64_t)hi << 32 | lo;
+}
+static inline uint32_t lo_of(share s) { return (uint32_t)s; }
+static inline uint32_t hi_of(share s) { return (uint32_t)(s >> 32); }
+
+struct pool {
+  Workpool_task *task;
+  void *cl;
+  int nthreads;
+  share *shares; // one per thread
+};
+
+struct worker {
+  struct pool *pool;
+  int id;
+};
+
+// claims the first task of thread id's share, or returns -1 if it is empty
+static int take_own(struct pool *p, int id) {
+  share s = __atomic_load_n(&p->shares[id], __ATOMIC_ACQUIRE);
+  while (lo_of(s) < hi_of(s)) {
+    if (__atomic_compare_exchange_n(&p->shares[id], &s,
+                                    pack(lo_of(s) + 1, hi_of(s)), 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return lo_of(s);
+  }
+  return -1;
+}
+
+// moves the back half of the largest other share into thread id's share.
+// Returns 0 once every share is empty
+static int steal(struct pool *p, int id) {
+  for (;;) {
+    int victim = -1;
+    uint32_t most = 0;
+    share seen = 0;
+    for (int t = 0; t < p->nthreads; t++) {
+      share s = __atomic_load_n(&p->shares[t], __ATOMIC_ACQUIRE);
+      if (t != id && hi_of(s) > lo_of(s) && hi_of(s) - lo_of(s) > most) {
+        victim = t;
+        most = hi_of(s) - lo_of(s);
+        seen = s;
+      }
+    }
+    if (victim < 0)
+      return 0;
+    uint32_t mid = hi_of(seen) - (most + 1) / 2;
+    if (__atomic_compare_exchange_n(&p->shares[victim], &seen,
+                                    pack(lo_of(seen), mid), 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      __atomic_store_n(&p->shares[id], pack(mid, hi_of(seen)),
+                       __ATOMIC_RELEASE);
+      return 1;
+    }
+  }
+}
+
+static void *work(void *vworker) {
+  struct worker *w = vworker;
+  struct pool *p = w->pool;
+  do {
+    int task;
+    while ((task = take_own(p, w->id)) >= 0)
+      p->task(task, p->cl);
+  } while (steal(p, w->id));
+  return NULL;
+}
+
+int Workpool_threads(int requested) {
+  if (requested > 0)
+    return requested;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (int)cpus : 1;
+}
+
+void Workpool_run(int ntasks, int nthreads, Workpool_task *task, void *cl) {
+  assert(ntasks >= 0 && task != NULL);
+  nthreads = Workpool_threads(nthreads);
+  if (nthreads > ntasks)
+    nthreads = ntasks;
+  if (nthreads <= 1) {
+    for (int i = 0; i < ntasks; i++)
+      task(i, cl);
+    return;
+  }
+  struct pool p = { task, cl, nthreads, NULL };
+  p.shares = CALLOC(nthreads, sizeof(share));
+  struct worker *workers = CALLOC(nthreads, sizeof(struct worker));
+  pthread_t *threads = CALLOC(nthreads, sizeof(pthread_t));
+  for (int t = 0; t < nthreads; t++) {
+    p.shares[t] = pack((int64_t)ntasks * t / nthreads,
+                       (int64_t)ntasks * (t + 1) / nthreads);
+    workers[t].pool = &p;
+    workers[t].id = t;
+  }
+  // thread 0 is the caller; a thread that fails to start leaves its share
+  // to be stolen
+  int started = 1;
+  for (; started < nthreads; started++)
+    if (pthread_create(&threads[started], NULL, work, &workers[started]))
+      break;
+  work(&workers[0]);
+  for (int t = 1; t < started; t++)
+    pthread_join(threads[t], NULL);
+  FREE(threads);
+  FREE(workers);
+  FREE(p.shares);
+}
@@ -0,0 +1,43 @@
+/***********************************************
+Work Pool
+Spencer Meldrum and Tim Alander
+
+This interface runs a numbered set of independent tasks on several threads.
+Each thread starts with an equal, contiguous share of the task numbers and
+works through it from the front.  A thread that runs out steals the back
+half of the largest share left, so a thread slowed by a busy core does not
+hold up the others.  Shares are claimed with compare-and-swap, so handing
+out a task takes no lock.
+***********************************************/
+
+#ifndef WORKPOOL_INCLUDED
+#define WORKPOOL_INCLUDED
+
+/***********************************************
+Type: Workpool_task
+Purpose: The function a client supplies.  It is called once for every task
+number from 0 to ntasks-1, from several threads at once, so it must only
+touch state that belongs to its task.
+***********************************************/
+typedef void Workpool_task(int task, void *cl);
+
+/***********************************************
+Function: Workpool_threads
+Arguments: a requested number of threads
+Purpose: This function returns the request if it is positive and the number
+of online processors otherwise.
+***********************************************/
+int Workpool_threads(int requested);
+
+/***********************************************
+Function: Workpool_run
+Arguments: the number of tasks, the number of threads (0 for one per online
+processor), the task function and a closure for it
+Purpose: This function runs every task and returns when all are done.  The
+calling thread is one of the workers.  With one thread or one task no
+threads are started, and if a thread cannot be started the others do its
+share.
+***********************************************/
+void Workpool_run(int ntasks, int nthreads, Workpool_task *task, void *cl);
+
+#endif